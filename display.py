@@ -1,53 +1,47 @@
 import csv
 import os
-import re
+import sys
 import matplotlib.pyplot as plt
 
-# Read data from CSV
+# Read data from CSV written by `nbody --bench`
+# One row per (engine, bodies, systems, threads) run, in the order they were benchmarked.
 
-file_path = 'benchmark_results.csv'
+file_path = sys.argv[1] if len(sys.argv) > 1 else 'benchmark_results.csv'
 
+runs = {}
+with open(file_path, 'r') as csvfile:
+    reader = csv.DictReader(csvfile)
+    for row in reader:
+        threads = int(row['threads'])
+        systems = int(row.get('systems', 1))
+        engine = row['engine']
+        series = runs.setdefault((threads, systems), {}).setdefault(engine, ([], [], []))
+        series[0].append(int(row['bodies']))
+        series[1].append(float(row['median']))
+        series[2].append(float(row['stddev']))
 
-for i in range(8):
-    file_p = f"{i}_{file_path}"
-
-
-    methods = {}
-    x_labels = []
-    num_threads = -1;
-
-    with open(file_p, 'r') as csvfile:
-        reader = csv.reader(csvfile)
-        headers = next(reader)
-        x_labels = list(map(int, headers[1:]))  # skip 'Method'
-
-        for row in reader:
-            method = row[0]
-            if num_threads == -1:
-                match = re.search(r'\d+', method)
-                if match:
-                    num_threads = int(match.group(0))
-
-            timings = list(map(float, row[1:]))
-            methods[method] = timings
+for (num_threads, num_systems), methods in runs.items():
+    name = f"stats_{num_threads}.png" if num_systems == 1 else f"stats_{num_threads}_{num_systems}.png"
 
 # Plot
     plt.figure(figsize=(10, 6))
-    for method, timings in methods.items():
-        plt.plot(x_labels, timings, marker='o', label=method)
+    for method, (bodies, medians, stddevs) in methods.items():
+        plt.errorbar(bodies, medians, yerr=stddevs, marker='o', capsize=3, label=method)
 
 # Labels and title
-    plt.xlabel("Number of Operations")
-    plt.ylabel("Time (seconds)")
-    plt.title(f"Performance Comparison of Threading Methods -- Threads ({num_threads})")
+    plt.xlabel("Number of Bodies")
+    plt.ylabel("Median time (seconds)")
+    title = f"Performance Comparison of Threading Methods -- Threads ({num_threads})"
+    if num_systems > 1:
+        title += f", Systems ({num_systems})"
+    plt.title(title)
     plt.legend()
     plt.grid(True)
     plt.tight_layout()
 
-    if os.path.exists(f"stats_{num_threads}.png"):
-        os.remove(f"stats_{num_threads}.png")
+    if os.path.exists(name):
+        os.remove(name)
 
-    plt.savefig(f"stats_{num_threads}.png")
+    plt.savefig(name)
 # Show the plot
     plt.show()
-
@@ -0,0 +1,207 @@
+#include <AutoTune.hpp>
+#include <Engines.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <omp.h>
+#include <sstream>
+
+// Each candidate is timed for at most this many single steps, and dropped
+// after the first one if it is already this many times slower than the best.
+static const int TUNE_TRIALS = 3;
+static const double TUNE_GIVE_UP = 3.0;
+
+std::string CpuModel()
+{
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+        if (line.compare(0, 10, "model name") != 0)
+            continue;
+        size_t colon = line.find(':');
+        if (colon == std::string::npos)
+            break;
+        std::string model = line.substr(line.find_first_not_of(" \t", colon + 1));
+        std::replace(model.begin(), model.end(), '\t', ' ');
+        return model;
+    }
+    return "unknown";
+}
+
+int SizeBucket(int n)
+{
+    int bucket = 0;
+    while (n > 1) {
+        n >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static bool ParseLine(const std::string& line, std::string& cpu, int& bucket, TunedConfig& config)
+{
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, '\t'))
+        fields.push_back(field);
+    if (fields.size() != 6)
+        return false;
+
+    cpu = fields[0];
+    bucket = std::atoi(fields[1].c_str());
+    config.engine = fields[2];
+    config.threads = std::max(1, std::atoi(fields[3].c_str()));
+    config.tiles = { 0, 0 };
+    std::sscanf(fields[4].c_str(), "%dx%d", &config.tiles.iBlock, &config.tiles.jTile);
+    config.secondsPerStep = std::atof(fields[5].c_str());
+    return true;
+}
+
+static std::string FormatLine(const std::string& cpu, int bucket, const TunedConfig& config)
+{
+    std::ostringstream line;
+    line << cpu << '\t' << bucket << '\t' << config.engine << '\t' << config.threads << '\t'
+         << config.tiles.iBlock << 'x' << config.tiles.jTile << '\t' << config.secondsPerStep;
+    return line.str();
+}
+
+bool LoadTunedConfig(const std::string& path, const std::string& cpu, int bucket, TunedConfig& config)
+{
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string lineCpu;
+        int lineBucket;
+        TunedConfig entry;
+        if (ParseLine(line, lineCpu, lineBucket, entry) && lineCpu == cpu && lineBucket == bucket) {
+            config = entry;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SaveTunedConfig(const std::string& path, const std::string& cpu, int bucket, const TunedConfig& config)
+{
+    // Keep every other entry, replace ours, and swap the file in whole.
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(path);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::string lineCpu;
+            int lineBucket;
+            TunedConfig entry;
+            if (ParseLine(line, lineCpu, lineBucket, entry) && !(lineCpu == cpu && lineBucket == bucket))
+                lines.push_back(line);
+        }
+    }
+    lines.push_back(FormatLine(cpu, bucket, config));
+
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp);
+        for (const std::string& line : lines)
+            file << line << '\n';
+        if (!file)
+            return false;
+    }
+    return rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+static bool TimeStep(const Engine& engine, const std::vector<Body>& bodies, double G, double deltaTime, int width, int height, double& seconds)
+{
+    std::vector<Body> copy = bodies;
+    const auto start(std::chrono::steady_clock::now());
+    bool ok = RunEngine(engine, copy, G, deltaTime, width, height, 1);
+    const auto end(std::chrono::steady_clock::now());
+    seconds = std::chrono::duration<double>(end - start).count();
+    return ok;
+}
+
+TunedConfig AutoTune(const std::vector<Body>& bodies, double G, double deltaTime, int width, int height)
+{
+    const int savedThreads = omp_get_max_threads();
+    const TileConfig savedTiles = GetTileConfig();
+    const TileConfig detected = DetectTileConfig();
+
+    std::vector<int> threadCounts;
+    const int procs = std::max(savedThreads, omp_get_num_procs());
+    for (int t = 1; t < procs; t *= 2)
+        threadCounts.push_back(t);
+    threadCounts.push_back(procs);
+
+    std::vector<TunedConfig> candidates;
+    for (const Engine& engine : Engines()) {
+        // The run is driven one frame at a time, so only engines with a per-step
+        // force pass fit; a run hook would pay its setup on every frame.
+        if (!engine.exact || !engine.calc)
+            continue;
+        for (int threads : threadCounts) {
+            TunedConfig c;
+            c.engine = engine.name;
+            c.threads = threads;
+            if (engine.name != "tiled") {
+                candidates.push_back(c);
+                continue;
+            }
+            for (TileConfig tiles : { detected, TileConfig { detected.iBlock / 4, detected.jTile }, TileConfig { detected.iBlock, detected.jTile / 4 } }) {
+                c.tiles = tiles;
+                candidates.push_back(c);
+            }
+        }
+    }
+
+    TunedConfig best;
+    best.secondsPerStep = 1e300;
+    for (TunedConfig& c : candidates) {
+        Engine engine;
+        FindEngine(c.engine, engine);
+        ApplyTunedConfig(c);
+
+        double fastest = 1e300;
+        bool failed = false;
+        for (int trial = 0; trial < TUNE_TRIALS && !failed; trial++) {
+            double seconds;
+            failed = !TimeStep(engine, bodies, G, deltaTime, width, height, seconds);
+            fastest = std::min(fastest, seconds);
+            if (fastest > TUNE_GIVE_UP * best.secondsPerStep)
+                break;
+        }
+        c.secondsPerStep = fastest;
+        if (!failed && fastest < best.secondsPerStep)
+            best = c;
+    }
+
+    omp_set_num_threads(savedThreads);
+    SetTileConfig(savedTiles);
+    return best;
+}
+
+TunedConfig TunedConfigFor(const std::vector<Body>& bodies, double G, double deltaTime, int width, int height,
+    const std::string& profilePath, bool retune)
+{
+    const std::string cpu = CpuModel();
+    const int bucket = SizeBucket(bodies.size());
+
+    // Profiles written before tuning was limited to per-step engines may name
+    // a run-hook engine; those entries are retuned.
+    TunedConfig config;
+    Engine engine;
+    if (!retune && LoadTunedConfig(profilePath, cpu, bucket, config) && FindEngine(config.engine, engine) && engine.calc)
+        return config;
+
+    config = AutoTune(bodies, G, deltaTime, width, height);
+    if (!SaveTunedConfig(profilePath, cpu, bucket, config))
+        fprintf(stderr, "Could not write tuning profile %s\n", profilePath.c_str());
+    return config;
+}
+
+void ApplyTunedConfig(const TunedConfig& config)
+{
+    omp_set_num_threads(std::max(1, config.threads));
+    if (config.tiles.iBlock > 0 && config.tiles.jTile > 0)
+        SetTileConfig(config.tiles);
+}
@@ -0,0 +1,38 @@
+#ifndef AUTO_TUNE_HPP
+#define AUTO_TUNE_HPP
+
+#include "Body.hpp"
+#include "Simulation.hpp"
+#include <string>
+#include <vector>
+
+// Winning configuration for one machine and problem size.
+struct TunedConfig {
+    std::string engine; // FindEngine spec
+    int threads = 1;
+    TileConfig tiles = { 0, 0 }; // only meaningful for the tiled engine
+    double secondsPerStep = 0;
+};
+
+// "model name" from /proc/cpuinfo, or "unknown".
+std::string CpuModel();
+// Problem sizes are tuned per power of two: bucket b covers [2^b, 2^(b+1)).
+int SizeBucket(int n);
+
+// Profile file: one tab-separated line per (CPU model, bucket).
+bool LoadTunedConfig(const std::string& path, const std::string& cpu, int bucket, TunedConfig& config);
+bool SaveTunedConfig(const std::string& path, const std::string& cpu, int bucket, const TunedConfig& config);
+
+// Briefly times every exact engine at power-of-two thread counts (and a few
+// tile shapes for the tiled engine) on a copy of `bodies`; returns the fastest.
+TunedConfig AutoTune(const std::vector<Body>& bodies, double G, double deltaTime, int width, int height);
+
+// The profile entry for this CPU and bodies.size(), tuning and saving one
+// first when there is none or `retune` is set.
+TunedConfig TunedConfigFor(const std::vector<Body>& bodies, double G, double deltaTime, int width, int height,
+    const std::string& profilePath, bool retune = false);
+
+// Sets the OpenMP thread count and tile shape the configuration was tuned with.
+void ApplyTunedConfig(const TunedConfig& config);
+
+#endif // AUTO_TUNE_HPP
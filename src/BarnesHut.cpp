@@ -0,0 +1,228 @@
+#include <Morton.hpp>
+#include <Simulation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <omp.h>
+
+namespace {
+
+const int LEAF_SIZE = 8;
+const int MAX_LEVEL = 16; // 16 bits per axis in a 32-bit Morton key
+const int TASK_CUTOFF = 2048; // ranges smaller than this are built inline
+
+struct QuadNode {
+    double mass = 0;
+    double comx = 0, comy = 0;
+    double size = 0; // side length of the cell
+    int begin = 0, end = 0; // range in Morton order
+    int child[4] = { -1, -1, -1, -1 };
+    bool leaf = true;
+};
+
+struct QuadTree {
+    std::vector<uint32_t> keys;
+    std::vector<int> order;
+    std::vector<double> x, y, mass;
+    std::vector<QuadNode> nodes;
+    int nodeCount = 0;
+    double rootSize = 0;
+};
+
+int AllocateNode(QuadTree& tree)
+{
+    int index;
+#pragma omp atomic capture
+    index = tree.nodeCount++;
+    return index;
+}
+
+void Summarize(QuadTree& tree, QuadNode& node)
+{
+    double m = 0, cx = 0, cy = 0;
+    if (node.leaf) {
+        for (int k = node.begin; k < node.end; k++) {
+            m += tree.mass[k];
+            cx += tree.mass[k] * tree.x[k];
+            cy += tree.mass[k] * tree.y[k];
+        }
+    } else {
+        for (int c : node.child) {
+            if (c < 0)
+                continue;
+            const QuadNode& ch = tree.nodes[c];
+            m += ch.mass;
+            cx += ch.mass * ch.comx;
+            cy += ch.mass * ch.comy;
+        }
+    }
+    node.mass = m;
+    node.comx = m > 0 ? cx / m : 0;
+    node.comy = m > 0 ? cy / m : 0;
+}
+
+// Builds the node for keys[begin, end), which all share their top 2 * level bits.
+// Levels where every key falls in the same quadrant are skipped, so each internal
+// node has at least two children and the tree has at most 2n nodes.
+void BuildNode(QuadTree& tree, int nodeIndex, int begin, int end, int level)
+{
+    const uint32_t* keys = tree.keys.data();
+
+    while (level < MAX_LEVEL && end - begin > LEAF_SIZE) {
+        int shift = 2 * (MAX_LEVEL - level - 1);
+        if ((keys[begin] >> shift) != (keys[end - 1] >> shift))
+            break;
+        level++;
+    }
+
+    QuadNode& node = tree.nodes[nodeIndex];
+    node.begin = begin;
+    node.end = end;
+    node.size = tree.rootSize / (double)(1u << level);
+
+    if (level == MAX_LEVEL || end - begin <= LEAF_SIZE) {
+        node.leaf = true;
+        Summarize(tree, node);
+        return;
+    }
+
+    node.leaf = false;
+    int shift = 2 * (MAX_LEVEL - level - 1);
+    uint32_t prefix = (keys[begin] >> (shift + 2)) << 2;
+
+    int lo = begin;
+    for (int q = 0; q < 4; q++) {
+        uint32_t bound = (prefix | (uint32_t)q) + 1;
+        int hi = q == 3 ? end : (int)(std::lower_bound(keys + lo, keys + end, bound << shift) - keys);
+        if (hi > lo) {
+            int c = AllocateNode(tree);
+            node.child[q] = c;
+            if (hi - lo > TASK_CUTOFF) {
+#pragma omp task default(shared) firstprivate(c, lo, hi, level)
+                BuildNode(tree, c, lo, hi, level + 1);
+            } else {
+                BuildNode(tree, c, lo, hi, level + 1);
+            }
+        }
+        lo = hi;
+    }
+
+#pragma omp taskwait
+    Summarize(tree, tree.nodes[nodeIndex]);
+}
+
+void BuildTree(QuadTree& tree, const std::vector<Body>& bodies)
+{
+    const int n = bodies.size();
+
+    double minx = bodies[0].position.x, maxx = minx;
+    double miny = bodies[0].position.y, maxy = miny;
+#pragma omp parallel for reduction(min : minx, miny) reduction(max : maxx, maxy)
+    for (int i = 0; i < n; i++) {
+        minx = std::min(minx, bodies[i].position.x);
+        maxx = std::max(maxx, bodies[i].position.x);
+        miny = std::min(miny, bodies[i].position.y);
+        maxy = std::max(maxy, bodies[i].position.y);
+    }
+
+    tree.rootSize = std::max(std::max(maxx - minx, maxy - miny), 1e-9);
+    const double cells = (double)(1u << MAX_LEVEL);
+    const double toCell = (cells - 1) / tree.rootSize;
+
+    tree.keys.resize(n);
+    tree.order.resize(n);
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        uint32_t ix = (uint32_t)((bodies[i].position.x - minx) * toCell);
+        uint32_t iy = (uint32_t)((bodies[i].position.y - miny) * toCell);
+        tree.keys[i] = MortonKey(ix, iy);
+    }
+    std::iota(tree.order.begin(), tree.order.end(), 0);
+    RadixSortByKey(tree.keys, tree.order);
+
+    tree.x.resize(n);
+    tree.y.resize(n);
+    tree.mass.resize(n);
+#pragma omp parallel for
+    for (int k = 0; k < n; k++) {
+        int i = tree.order[k];
+        tree.x[k] = bodies[i].position.x;
+        tree.y[k] = bodies[i].position.y;
+        tree.mass[k] = bodies[i].mass;
+    }
+
+    tree.nodes.assign(2 * n + 1, QuadNode());
+    tree.nodeCount = 1;
+
+#pragma omp parallel
+#pragma omp single
+    BuildNode(tree, 0, 0, n, 0);
+}
+
+Vec2 TreeAcceleration(const QuadTree& tree, double px, double py, double G, double theta)
+{
+    const double theta2 = theta * theta;
+    double ax = 0, ay = 0;
+
+    int stack[4 * MAX_LEVEL + 4];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const QuadNode& node = tree.nodes[stack[--top]];
+
+        if (node.leaf) {
+            for (int k = node.begin; k < node.end; k++) {
+                double dx = tree.x[k] - px;
+                double dy = tree.y[k] - py;
+                double r2 = dx * dx + dy * dy;
+                if (r2 < 1e-12)
+                    continue;
+                double s = G * tree.mass[k] / ((r2 + SOFTENING) * std::sqrt(r2));
+                ax += dx * s;
+                ay += dy * s;
+            }
+            continue;
+        }
+
+        double dx = node.comx - px;
+        double dy = node.comy - py;
+        double r2 = dx * dx + dy * dy;
+
+        // Opening criterion: size / distance < theta
+        if (node.size * node.size < theta2 * r2) {
+            double s = G * node.mass / ((r2 + SOFTENING) * std::sqrt(r2));
+            ax += dx * s;
+            ay += dy * s;
+            continue;
+        }
+
+        for (int c : node.child) {
+            if (c >= 0)
+                stack[top++] = c;
+        }
+    }
+
+    return { ax, ay };
+}
+
+} // namespace
+
+void CalculateForcesBarnesHut(std::vector<Body>& bodies, double G, double theta)
+{
+    const int n = bodies.size();
+    if (n == 0)
+        return;
+
+    QuadTree tree;
+    BuildTree(tree, bodies);
+
+    // Walk in Morton order so consecutive bodies reuse the same tree paths.
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int k = 0; k < n; k++) {
+        Vec2 acc = TreeAcceleration(tree, tree.x[k], tree.y[k], G, theta);
+        Body& b = bodies[tree.order[k]];
+        b.velocity = add(b.velocity, acc);
+    }
+}
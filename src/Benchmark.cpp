@@ -0,0 +1,166 @@
+#include <Benchmark.hpp>
+#include <Engines.hpp>
+#include <Morton.hpp>
+#include <Numa.hpp>
+#include <Simulation.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <omp.h>
+
+static bool TimeRun(const Engine& engine, std::vector<std::vector<Body>>& systems, const BenchmarkConfig& config, double& seconds)
+{
+    const auto start(std::chrono::steady_clock::now());
+    bool ok = RunEngineBatch(engine, systems, config.gravity, config.deltaTime, config.width, config.height, config.steps);
+    const auto end(std::chrono::steady_clock::now());
+    seconds = std::chrono::duration<double>(end - start).count();
+    return ok;
+}
+
+static void Errors(const std::vector<std::vector<Body>>& reference, const std::vector<std::vector<Body>>& systems, double& velocityError, double& positionError)
+{
+    double dv = 0, norm = 0, dp = 0;
+    size_t count = 0;
+    for (size_t s = 0; s < systems.size(); s++) {
+        const std::vector<Body>& bodies = systems[s];
+        for (int i = 0; i < bodies.size(); i++) {
+            Vec2 v = sub(reference[s][i].velocity, bodies[i].velocity);
+            Vec2 p = sub(reference[s][i].position, bodies[i].position);
+            dv += v.x * v.x + v.y * v.y;
+            dp += p.x * p.x + p.y * p.y;
+            norm += reference[s][i].velocity.x * reference[s][i].velocity.x + reference[s][i].velocity.y * reference[s][i].velocity.y;
+        }
+        count += bodies.size();
+    }
+    velocityError = norm > 0 ? std::sqrt(dv / norm) : std::sqrt(dv);
+    positionError = count == 0 ? 0 : std::sqrt(dp / count);
+}
+
+std::vector<BenchmarkResult> RunBenchmarks(const BenchmarkConfig& config)
+{
+    std::vector<BenchmarkResult> results;
+
+    std::vector<Engine> engines;
+    for (const std::string& spec : config.engines) {
+        Engine engine;
+        if (!FindEngine(spec, engine)) {
+            fprintf(stderr, "Unknown engine: %s\n", spec.c_str());
+            continue;
+        }
+        engines.push_back(engine);
+    }
+
+    Engine reference;
+    FindEngine("sequential", reference);
+
+    for (int numBodies : config.bodyCounts) {
+        const int numSystems = std::max(1, config.systems);
+        std::vector<std::vector<Body>> initial(numSystems);
+        for (int s = 0; s < numSystems; s++) {
+            initial[s] = config.generate(numBodies, s);
+            if (config.reorder) {
+                std::vector<int> ids;
+                ReorderMorton(initial[s], ids);
+            }
+        }
+
+        std::vector<std::vector<Body>> expected = initial;
+        double seconds;
+        TimeRun(reference, expected, config, seconds);
+
+        if (numSystems > 1)
+            printf("--- BODIES: %d x %d systems ---\n", numBodies, numSystems);
+        else
+            printf("--- BODIES: %d ---\n", numBodies);
+
+        for (const Engine& engine : engines) {
+            for (int threads : config.threadCounts) {
+                omp_set_num_threads(threads);
+                PinOpenMPThreads();
+
+                std::vector<std::vector<Body>> bodies;
+                bool ok = true;
+                for (int w = 0; w < config.warmup && ok; w++) {
+                    bodies = initial;
+                    ok = TimeRun(engine, bodies, config, seconds);
+                }
+
+                std::vector<double> times;
+                for (int t = 0; t < std::max(1, config.trials) && ok; t++) {
+                    bodies = initial;
+                    ok = TimeRun(engine, bodies, config, seconds);
+                    times.push_back(seconds);
+                }
+                if (!ok) {
+                    fprintf(stderr, "%s failed with %d threads; no result recorded\n", engine.name.c_str(), threads);
+                    continue;
+                }
+
+                BenchmarkResult r;
+                r.engine = engine.name;
+                r.bodies = numBodies;
+                r.systems = numSystems;
+                r.threads = threads;
+                r.steps = config.steps;
+                r.trials = times.size();
+
+                std::sort(times.begin(), times.end());
+                size_t mid = times.size() / 2;
+                r.median = times.size() % 2 ? times[mid] : 0.5 * (times[mid - 1] + times[mid]);
+                r.min = times.front();
+                r.mean = 0;
+                for (double t : times)
+                    r.mean += t;
+                r.mean /= times.size();
+                r.stddev = 0;
+                for (double t : times)
+                    r.stddev += (t - r.mean) * (t - r.mean);
+                r.stddev = times.size() > 1 ? std::sqrt(r.stddev / (times.size() - 1)) : 0;
+
+                double interactions = (double)numBodies * (numBodies - 1) * config.steps * numSystems;
+                r.interactionsPerSecond = r.median > 0 ? interactions / r.median : 0;
+                r.gflops = r.interactionsPerSecond * FLOPS_PER_INTERACTION * 1e-9;
+
+                Errors(expected, bodies, r.velocityError, r.positionError);
+
+                printf("%-20s threads %3d  median %.6fs  min %.6fs  sd %.2e  %.3e int/s  %.2f GFLOP/s  err %.2e\n",
+                    r.engine.c_str(), threads, r.median, r.min, r.stddev, r.interactionsPerSecond, r.gflops, r.velocityError);
+
+                results.push_back(r);
+            }
+        }
+    }
+
+    return results;
+}
+
+void WriteBenchmarkCSV(const std::string& path, const std::vector<BenchmarkResult>& results)
+{
+    std::ofstream stream(path);
+    stream << "engine,bodies,systems,threads,steps,trials,median,min,mean,stddev,interactions_per_second,gflops,velocity_error,position_error\n";
+    stream.precision(9);
+    for (const BenchmarkResult& r : results) {
+        stream << r.engine << "," << r.bodies << "," << r.systems << "," << r.threads << "," << r.steps << "," << r.trials << ","
+               << r.median << "," << r.min << "," << r.mean << "," << r.stddev << ","
+               << r.interactionsPerSecond << "," << r.gflops << "," << r.velocityError << "," << r.positionError << "\n";
+    }
+}
+
+void WriteBenchmarkJSON(const std::string& path, const std::vector<BenchmarkResult>& results)
+{
+    std::ofstream stream(path);
+    stream.precision(9);
+    stream << "[\n";
+    for (size_t k = 0; k < results.size(); k++) {
+        const BenchmarkResult& r = results[k];
+        stream << "  {\"engine\": \"" << r.engine << "\", \"bodies\": " << r.bodies << ", \"systems\": " << r.systems << ", \"threads\": " << r.threads
+               << ", \"steps\": " << r.steps << ", \"trials\": " << r.trials
+               << ", \"median\": " << r.median << ", \"min\": " << r.min << ", \"mean\": " << r.mean << ", \"stddev\": " << r.stddev
+               << ", \"interactions_per_second\": " << r.interactionsPerSecond << ", \"gflops\": " << r.gflops
+               << ", \"velocity_error\": " << r.velocityError << ", \"position_error\": " << r.positionError << "}"
+               << (k + 1 < results.size() ? "," : "") << "\n";
+    }
+    stream << "]\n";
+}
@@ -0,0 +1,55 @@
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include "Body.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+
+struct BenchmarkConfig {
+    std::vector<std::string> engines;
+    std::vector<int> bodyCounts;
+    std::vector<int> threadCounts;
+    int steps = 1;
+    int warmup = 1;
+    int trials = 5;
+    double gravity = 9.8;
+    double deltaTime = 0.07;
+    int width = 1920;
+    int height = 1080;
+    // Independent systems per run, each of the given body count.
+    int systems = 1;
+    // Sort each initial state into Morton order before timing.
+    bool reorder = false;
+    // generate(bodies, system) builds the initial state of one system.
+    std::function<std::vector<Body>(int, int)> generate;
+};
+
+struct BenchmarkResult {
+    std::string engine;
+    int bodies;
+    int systems;
+    int threads;
+    int steps;
+    int trials;
+    double median; // seconds per run of `steps` steps
+    double min;
+    double mean;
+    double stddev;
+    double interactionsPerSecond; // direct-sum equivalent pair interactions, all systems
+    double gflops;
+    double velocityError; // relative L2 error vs the sequential reference
+    double positionError; // RMS position difference vs the sequential reference
+};
+
+// Floating point operations counted per pair interaction for the GFLOP/s figure.
+const int FLOPS_PER_INTERACTION = 20;
+
+// Runs every engine x body count x thread count combination in the order given,
+// so results (and the files written from them) have a stable ordering.
+std::vector<BenchmarkResult> RunBenchmarks(const BenchmarkConfig& config);
+
+void WriteBenchmarkCSV(const std::string& path, const std::vector<BenchmarkResult>& results);
+void WriteBenchmarkJSON(const std::string& path, const std::vector<BenchmarkResult>& results);
+
+#endif // BENCHMARK_HPP
@@ -0,0 +1,192 @@
+#include <BodySoA.hpp>
+#include <Simulation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static const int BLOCK_CHUNK = 16;
+
+// Softened pair acceleration G * m * d / ((r^2 + eps) * r) on each target
+// body, and its time derivative (the jerk) from the same pass, Hermite-style:
+// both share r, the force factor and the skip test.
+static void AccelerationAndJerk(const BodySoA& soa, const std::vector<int>& targets, double G, double* ax, double* ay,
+    double* jx, double* jy)
+{
+    const int n = soa.size();
+    const int count = targets.size();
+    const double* x = soa.x.data();
+    const double* y = soa.y.data();
+    const double* vx = soa.vx.data();
+    const double* vy = soa.vy.data();
+    const double* m = soa.mass.data();
+
+#pragma omp parallel for schedule(dynamic, BLOCK_CHUNK)
+    for (int k = 0; k < count; k++) {
+        const int i = targets[k];
+        double axi = 0, ayi = 0;
+        double jxi = 0, jyi = 0;
+
+#pragma omp simd reduction(+ : axi, ayi, jxi, jyi)
+        for (int j = 0; j < n; j++) {
+            double dx = x[j] - x[i];
+            double dy = y[j] - y[i];
+            double dvx = vx[j] - vx[i];
+            double dvy = vy[j] - vy[i];
+            double r2 = dx * dx + dy * dy;
+            double f = SoftenedGravity()(r2, G * m[j]);
+            // f is 0 exactly for the pairs the law skips, r2 = 0 among them.
+            double rv = f == 0.0 ? 0.0 : (dx * dvx + dy * dvy) * (3 * r2 + SOFTENING) / ((r2 + SOFTENING) * r2);
+            axi += f * dx;
+            ayi += f * dy;
+            jxi += f * (dvx - dx * rv);
+            jyi += f * (dvy - dy * rv);
+        }
+
+        ax[i] = axi;
+        ay[i] = ayi;
+        jx[i] = jxi;
+        jy[i] = jyi;
+    }
+}
+
+// Aarseth-style step eta * |a| / |j|, rounded down to a power-of-two fraction
+// of the base step. Returns the level l with step deltaTime / 2^l.
+static int ChooseLevel(double ax, double ay, double jx, double jy, double eta, double deltaTime, int maxLevel)
+{
+    double a = std::sqrt(ax * ax + ay * ay);
+    double j = std::sqrt(jx * jx + jy * jy);
+    if (j == 0)
+        return 0;
+    double ratio = eta * a / (j * deltaTime);
+    int level = 0;
+    while (level < maxLevel && ratio < 1.0) {
+        ratio *= 2;
+        level++;
+    }
+    return level;
+}
+
+bool BlockTimestepState::Matches(const std::vector<Body>& bodies) const
+{
+    if (soa.size() != (int)bodies.size())
+        return false;
+    for (int i = 0; i < soa.size(); i++) {
+        const Body& b = bodies[i];
+        if (b.position.x != soa.x[i] || b.position.y != soa.y[i] || b.velocity.x != soa.vx[i] || b.velocity.y != soa.vy[i])
+            return false;
+    }
+    return true;
+}
+
+BlockTimestepStats SimulateBlockTimesteps(std::vector<Body>& bodies, double G, double deltaTime, int width, int height, int steps, const BlockTimestepConfig& config,
+    BlockTimestepState* state)
+{
+    BlockTimestepStats stats;
+    const int n = bodies.size();
+    if (n == 0 || steps <= 0)
+        return stats;
+
+    // Time is counted in ticks of the finest step, deltaTime / 2^maxLevel. A
+    // body on level l is active every 2^(maxLevel - l) ticks.
+    const int maxLevel = std::max(0, std::min(config.maxLevel, 20));
+    const long long ticksPerStep = 1LL << maxLevel;
+    const long long endTick = ticksPerStep * steps;
+    const double tickTime = deltaTime / ticksPerStep;
+
+    BlockTimestepState local;
+    BlockTimestepState& buffers = state ? *state : local;
+    const bool carried = state && state->maxLevel == maxLevel && state->Matches(bodies);
+    BodySoA& soa = buffers.soa;
+    soa.Load(bodies);
+    AlignedVector<double>& ax = buffers.ax;
+    AlignedVector<double>& ay = buffers.ay;
+    AlignedVector<double>& jx = buffers.jx;
+    AlignedVector<double>& jy = buffers.jy;
+    std::vector<int>& level = buffers.level;
+    std::vector<long long>& lastTick = buffers.lastTick;
+    std::vector<int>& active = buffers.active;
+    ax.resize(n);
+    ay.resize(n);
+    jx.resize(n);
+    jy.resize(n);
+    level.resize(n);
+    lastTick.assign(n, 0);
+    active.resize(n);
+    for (int i = 0; i < n; i++)
+        active[i] = i;
+
+    long long tick = 0;
+    while (true) {
+        const int count = active.size();
+
+        // The jerk is taken before the closing half-kick below, with the
+        // velocities the bodies had over the step that just ended. A carried
+        // state already holds both for tick 0, and its kicks are closed.
+        if (!carried || tick > 0) {
+            AccelerationAndJerk(soa, active, G, ax.data(), ay.data(), jx.data(), jy.data());
+            stats.forceEvaluations += (long long)count * n;
+            stats.substeps++;
+        }
+
+        // Close the previous kick of each active body, then open the next one
+        // on its new level. Everyone is synchronized at the end, so the final
+        // pass only closes.
+        if (tick > 0) {
+#pragma omp parallel for
+            for (int k = 0; k < count; k++) {
+                int i = active[k];
+                double half = 0.5 * tickTime * (ticksPerStep >> level[i]);
+                soa.vx[i] += half * ax[i];
+                soa.vy[i] += half * ay[i];
+            }
+        }
+        if (tick == endTick)
+            break;
+
+#pragma omp parallel for
+        for (int k = 0; k < count; k++) {
+            int i = active[k];
+            int wanted = ChooseLevel(ax[i], ay[i], jx[i], jy[i], config.eta, deltaTime, maxLevel);
+            // Refining is always allowed; coarsening only by one level, and only
+            // when the current tick lies on the coarser block boundary.
+            if ((tick > 0 || carried) && wanted < level[i]) {
+                wanted = level[i] - 1;
+                if (tick % (ticksPerStep >> wanted) != 0)
+                    wanted = level[i];
+            }
+            level[i] = wanted;
+            lastTick[i] = tick;
+
+            double half = 0.5 * tickTime * (ticksPerStep >> wanted);
+            soa.vx[i] += half * ax[i];
+            soa.vy[i] += half * ay[i];
+        }
+
+        long long next = endTick;
+        for (int i = 0; i < n; i++)
+            next = std::min(next, lastTick[i] + (ticksPerStep >> level[i]));
+
+        // Every body drifts to the next block boundary; inactive ones carry
+        // their mid-step velocity, as in leapfrog.
+        const double drift = (next - tick) * tickTime;
+#pragma omp parallel for
+        for (int i = 0; i < n; i++) {
+            soa.x[i] += soa.vx[i] * drift;
+            soa.y[i] += soa.vy[i] * drift;
+            if ((soa.x[i] < 0 && soa.vx[i] < 0) || (soa.x[i] > width && soa.vx[i] > 0))
+                soa.vx[i] *= -1;
+            if ((soa.y[i] < 0 && soa.vy[i] < 0) || (soa.y[i] > height && soa.vy[i] > 0))
+                soa.vy[i] *= -1;
+        }
+        tick = next;
+
+        active.clear();
+        for (int i = 0; i < n; i++)
+            if (lastTick[i] + (ticksPerStep >> level[i]) == tick)
+                active.push_back(i);
+    }
+
+    soa.Store(bodies);
+    buffers.maxLevel = maxLevel;
+    return stats;
+}
@@ -2,12 +2,25 @@
 #define BODY_HPP
 #include <Vec.hpp>
 
-struct Body {
-    Vec2 position;
-    Vec2 velocity;
-    double mass;
+// Softening added to the squared distance so close encounters stay finite.
+const double SOFTENING = 0.1;
+
+template <typename T, int D>
+struct BodyT {
+    Vec<T, D> position;
+    Vec<T, D> velocity;
+    T mass;
 };
 
-double Force(const Body& b1, const Body& b2, double G);
+using Body = BodyT<double, 2>;
+using Body3 = BodyT<double, 3>;
+
+template <typename T, int D>
+inline T Force(const BodyT<T, D>& b1, const BodyT<T, D>& b2, T G)
+{
+    T distsq = distSqrd(b1.position, b2.position) + T(SOFTENING);
+
+    return b1.mass * b2.mass * G / distsq;
+}
 
 #endif // BODY_HPP
@@ -0,0 +1,38 @@
+#include <BodySoA.hpp>
+
+void BodySoA::Resize(int n)
+{
+    x.resize(n);
+    y.resize(n);
+    vx.resize(n);
+    vy.resize(n);
+    mass.resize(n);
+}
+
+void BodySoA::Load(const std::vector<Body>& bodies)
+{
+    const int n = bodies.size();
+    Resize(n);
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        x[i] = bodies[i].position.x;
+        y[i] = bodies[i].position.y;
+        vx[i] = bodies[i].velocity.x;
+        vy[i] = bodies[i].velocity.y;
+        mass[i] = bodies[i].mass;
+    }
+}
+
+void BodySoA::Store(std::vector<Body>& bodies) const
+{
+    const int n = size();
+    bodies.resize(n);
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++) {
+        bodies[i].position = { x[i], y[i] };
+        bodies[i].velocity = { vx[i], vy[i] };
+        bodies[i].mass = mass[i];
+    }
+}
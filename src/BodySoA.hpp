@@ -0,0 +1,56 @@
+#ifndef BODY_SOA_HPP
+#define BODY_SOA_HPP
+
+#include "Body.hpp"
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Minimal allocator that hands out storage aligned for full-width vector loads.
+template <typename T, std::size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) { }
+
+    T* allocate(std::size_t n)
+    {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* p, std::size_t)
+    {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// Structure-of-arrays copy of a body list, so the pair loop can stream
+// each component contiguously.
+struct BodySoA {
+    AlignedVector<double> x, y;
+    AlignedVector<double> vx, vy;
+    AlignedVector<double> mass;
+
+    int size() const { return (int)x.size(); }
+
+    void Resize(int n);
+    void Load(const std::vector<Body>& bodies);
+    void Store(std::vector<Body>& bodies) const;
+};
+
+#endif // BODY_SOA_HPP
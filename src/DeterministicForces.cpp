@@ -0,0 +1,144 @@
+#include <BodySoA.hpp>
+#include <Simulation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+
+// The j range of every row is cut into chunks of DET_CHUNK bodies. Each chunk
+// is summed in a fixed order and the chunk partials are combined by a fixed
+// pairwise tree, so the result depends only on n, never on which thread took
+// which piece or when.
+static const int DET_CHUNK = 512;
+static const int DET_ROWS = 16;
+// Bound on the partial buffer: rows * chunks per pass.
+static const long DET_MAX_PARTIALS = 1L << 20;
+
+// A sum with its running compensation term; c stays 0 when uncompensated.
+struct Partial {
+    double s = 0;
+    double c = 0;
+};
+
+// Error-free addition (Knuth's TwoSum); the rounding error is folded into c.
+static inline Partial Combine(Partial a, Partial b)
+{
+    Partial r;
+    r.s = a.s + b.s;
+    double bv = r.s - a.s;
+    double err = (a.s - (r.s - bv)) + (b.s - bv);
+    r.c = a.c + b.c + err;
+    return r;
+}
+
+static Partial PairwiseSum(const Partial* v, int count, bool compensated)
+{
+    if (count == 1)
+        return v[0];
+    int half = count / 2;
+    Partial a = PairwiseSum(v, half, compensated);
+    Partial b = PairwiseSum(v + half, count - half, compensated);
+    if (compensated)
+        return Combine(a, b);
+    Partial r;
+    r.s = a.s + b.s;
+    return r;
+}
+
+// Cloned per instruction set so the simd loop gets full-width vectors; the
+// lane shape of each clone is fixed, so results stay reproducible on a given CPU.
+__attribute__((target_clones("avx512f", "avx2", "default"))) static void ChunkSums(const BodySoA& soa, int i, int jb, int je, double G, bool compensated, Partial& ax, Partial& ay)
+{
+    const double* x = soa.x.data();
+    const double* y = soa.y.data();
+    const double* m = soa.mass.data();
+    const double xi = x[i], yi = y[i];
+
+    if (!compensated) {
+        double sx = 0, sy = 0;
+#pragma omp simd reduction(+ : sx, sy)
+        for (int j = jb; j < je; j++) {
+            double dx = x[j] - xi;
+            double dy = y[j] - yi;
+            double r2 = dx * dx + dy * dy;
+            double s = SoftenedGravity()(r2, G * m[j]);
+            sx += dx * s;
+            sy += dy * s;
+        }
+        ax = { sx, 0 };
+        ay = { sy, 0 };
+        return;
+    }
+
+    // Neumaier's variant of Kahan summation, in j order.
+    double sx = 0, sy = 0, cx = 0, cy = 0;
+    for (int j = jb; j < je; j++) {
+        double dx = x[j] - xi;
+        double dy = y[j] - yi;
+        double r2 = dx * dx + dy * dy;
+        double s = SoftenedGravity()(r2, G * m[j]);
+        double fx = dx * s, fy = dy * s;
+
+        double t = sx + fx;
+        cx += std::abs(sx) >= std::abs(fx) ? (sx - t) + fx : (fx - t) + sx;
+        sx = t;
+        t = sy + fy;
+        cy += std::abs(sy) >= std::abs(fy) ? (sy - t) + fy : (fy - t) + sy;
+        sy = t;
+    }
+    ax.s = sx, ax.c = cx;
+    ay.s = sy, ay.c = cy;
+}
+
+void CalculateForcesDeterministic(Simulation& sim, bool compensated)
+{
+    std::vector<Body>& bodies = sim.bodies;
+    const double G = sim.gravity;
+    const int n = bodies.size();
+    if (n == 0)
+        return;
+
+    sim.BeginStep();
+    BodySoA& soa = sim.soa;
+    soa.Load(bodies);
+
+    // Every slot below is written before it is read.
+    const int chunks = (n + DET_CHUNK - 1) / DET_CHUNK;
+    const int rowsPerPass = std::max((long)DET_ROWS, DET_MAX_PARTIALS / chunks / DET_ROWS * DET_ROWS);
+    const size_t partials = (size_t)std::min(rowsPerPass, n) * chunks;
+    ScratchArena& arena = sim.Arena(0);
+    Partial* px = arena.Allocate<Partial>(partials);
+    Partial* py = arena.Allocate<Partial>(partials);
+    Partial* ax = arena.Allocate<Partial>(n);
+    Partial* ay = arena.Allocate<Partial>(n);
+
+    for (int pass = 0; pass < n; pass += rowsPerPass) {
+        const int rows = std::min(rowsPerPass, n - pass);
+        const int groups = (rows + DET_ROWS - 1) / DET_ROWS;
+
+        // Any (row group, chunk) pair may run on any thread: each writes its
+        // own slot of the partial buffer.
+#pragma omp parallel for collapse(2) schedule(dynamic)
+        for (int g = 0; g < groups; g++) {
+            for (int c = 0; c < chunks; c++) {
+                const int jb = c * DET_CHUNK;
+                const int je = std::min(n, jb + DET_CHUNK);
+                const int rb = g * DET_ROWS;
+                const int re = std::min(rows, rb + DET_ROWS);
+                for (int r = rb; r < re; r++)
+                    ChunkSums(soa, pass + r, jb, je, G, compensated, px[(size_t)r * chunks + c], py[(size_t)r * chunks + c]);
+            }
+        }
+
+#pragma omp parallel for
+        for (int r = 0; r < rows; r++) {
+            ax[pass + r] = PairwiseSum(&px[(size_t)r * chunks], chunks, compensated);
+            ay[pass + r] = PairwiseSum(&py[(size_t)r * chunks], chunks, compensated);
+        }
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        bodies[i].velocity.x += ax[i].s + ax[i].c;
+        bodies[i].velocity.y += ay[i].s + ay[i].c;
+    }
+}
@@ -0,0 +1,171 @@
+#include <Simulation.hpp>
+#include <Transport.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <type_traits>
+#include <unistd.h>
+
+static_assert(std::is_trivially_copyable<Body>::value, "bodies travel the ring as raw bytes");
+
+// One rank's share of SimulateDistributed. The rank only owns its own bodies
+// and sees everyone else's as the blocks pass by on the ring. Processes stand
+// in for threads here, so nothing in a rank uses OpenMP (which does not
+// survive fork anyway).
+static bool RunRank(RingTransport& ring, std::vector<Body>& local, const std::vector<int>& offsets, double G, double deltaTime,
+    int width, int height, int steps)
+{
+    const int ranks = ring.ranks;
+    const int rank = ring.rank;
+    auto blockSize = [&](int origin) { return offsets[origin + 1] - offsets[origin]; };
+    auto originAt = [&](int pass) { return (rank - pass + ranks) % ranks; };
+
+    int capacity = 0;
+    for (int r = 0; r < ranks; r++)
+        capacity = std::max(capacity, blockSize(r));
+    std::vector<Body> current(capacity), incoming(capacity);
+
+    for (int s = 0; s < steps; s++) {
+        std::copy(local.begin(), local.end(), current.begin());
+
+        // Systolic pass: forward the block in hand, work on it while it travels,
+        // then pick up the one the previous rank forwarded.
+        for (int pass = 0; pass < ranks; pass++) {
+            const int count = blockSize(originAt(pass));
+            const bool forward = pass + 1 < ranks;
+            if (forward && !ring.StartSend(current.data(), count * sizeof(Body)))
+                return false;
+
+            for (int i = 0; i < local.size(); i++) {
+                for (int j = 0; j < count; j++) {
+                    if (pass == 0 && i == j)
+                        continue;
+
+                    Body& b1 = local[i];
+                    const Body& b2 = current[j];
+                    double force = Force(b1, b2, G);
+
+                    Vec2 dir = Direction(b1.position, b2.position);
+                    double acc1 = force / b1.mass; // F = ma => a = F / m
+
+                    b1.velocity = add(b1.velocity, scale(dir, acc1));
+                }
+            }
+
+            if (forward) {
+                if (!ring.Receive(incoming.data(), blockSize(originAt(pass + 1)) * sizeof(Body)) || !ring.WaitSend())
+                    return false;
+                std::swap(current, incoming);
+            }
+        }
+
+        UpdateSequential(local, deltaTime, width, height);
+    }
+
+    // Gather: one more lap of whole bodies, rank 0 keeping every block it sees.
+    std::vector<Body> all;
+    if (rank == 0) {
+        all.resize(offsets[ranks]);
+        std::copy(local.begin(), local.end(), all.begin());
+    }
+    std::copy(local.begin(), local.end(), current.begin());
+    for (int pass = 1; pass < ranks; pass++) {
+        const int origin = originAt(pass);
+        if (!ring.StartSend(current.data(), blockSize(originAt(pass - 1)) * sizeof(Body))
+            || !ring.Receive(incoming.data(), blockSize(origin) * sizeof(Body)) || !ring.WaitSend())
+            return false;
+        std::swap(current, incoming);
+        if (rank == 0)
+            std::copy(current.begin(), current.begin() + blockSize(origin), all.begin() + offsets[origin]);
+    }
+    if (rank == 0)
+        local.swap(all);
+    return true;
+}
+
+bool SimulateDistributed(std::vector<Body>& bodies, double G, double deltaTime, int width, int height, int steps, int ranks,
+    TransportKind transport)
+{
+    const int n = bodies.size();
+    ranks = std::max(1, std::min(ranks, n));
+
+    // Bodies [offsets[r], offsets[r + 1]) belong to rank r.
+    std::vector<int> offsets(ranks + 1);
+    int largest = 0;
+    for (int r = 0; r <= ranks; r++) {
+        offsets[r] = (int)((long long)n * r / ranks);
+        if (r > 0)
+            largest = std::max(largest, offsets[r] - offsets[r - 1]);
+    }
+
+    std::vector<std::unique_ptr<RingTransport>> ring = CreateRing(transport, ranks, largest * sizeof(Body));
+    if (ring.empty())
+        return false;
+
+    // Unflushed output would otherwise be written once per process.
+    fflush(stdout);
+    fflush(stderr);
+
+    // The calling process is rank 0; the others are forked copies.
+    const pid_t parent = getpid();
+    std::vector<pid_t> children;
+    bool ok = true;
+    for (int r = 1; r < ranks && ok; r++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            fprintf(stderr, "fork: %s\n", strerror(errno));
+            ok = false;
+            break;
+        }
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            std::unique_ptr<RingTransport> endpoint = std::move(ring[r]);
+            ring.clear();
+            endpoint->peersAlive = [parent] { return getppid() == parent; };
+            std::vector<Body> local(bodies.begin() + offsets[r], bodies.begin() + offsets[r + 1]);
+            bool rankOk = RunRank(*endpoint, local, offsets, G, deltaTime, width, height, steps);
+            endpoint.reset();
+            _exit(rankOk ? 0 : 1);
+        }
+        children.push_back(pid);
+    }
+
+    std::unique_ptr<RingTransport> endpoint = std::move(ring[0]);
+    ring.clear();
+    // A rank that died or failed breaks the ring; one that exited cleanly has
+    // already sent everything. WNOWAIT leaves the children to be reaped below.
+    endpoint->peersAlive = [&children] {
+        for (pid_t pid : children) {
+            siginfo_t info = {};
+            if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid != 0
+                && !(info.si_code == CLD_EXITED && info.si_status == 0))
+                return false;
+        }
+        return true;
+    };
+    if (ok) {
+        std::vector<Body> local(bodies.begin(), bodies.begin() + offsets[1]);
+        ok = RunRank(*endpoint, local, offsets, G, deltaTime, width, height, steps);
+        if (ok)
+            bodies.swap(local);
+    }
+    endpoint.reset();
+
+    // A rank that is still blocked on the ring would never exit by itself.
+    if (!ok) {
+        for (pid_t pid : children)
+            kill(pid, SIGKILL);
+    }
+    for (pid_t pid : children) {
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            ok = false;
+    }
+    if (!ok)
+        fprintf(stderr, "Distributed step failed\n");
+    return ok;
+}
@@ -0,0 +1,185 @@
+#include <Engines.hpp>
+#include <ForceLaw.hpp>
+#include <Simulation.hpp>
+#include <ThreadPool.hpp>
+#include <Trace.hpp>
+#include <cstdlib>
+#include <omp.h>
+
+const std::vector<Engine>& Engines()
+{
+    static const std::vector<Engine> engines = {
+        { "sequential", CalculateForcesSequential, UpdateSequential, true },
+        { "reduction-dynamic", CalculateForcesMTReduction, UpdateMT, true },
+        { "reduction-static", CalculateForcesMTReductionStatic, UpdateMT, true },
+        { "atomic-dynamic", CalculateForcesMTAtomic, UpdateMT, true },
+        { "atomic-static", CalculateForcesMTAtomicStatic, UpdateMT, true },
+        { "critical", CalculateForcesMTCritical, UpdateMT, true },
+        { "simd", [](Simulation& s) { CalculateForcesSIMD(s); }, UpdateMT, true },
+        { "deterministic", [](Simulation& s) { CalculateForcesDeterministic(s); }, UpdateMT, true },
+        { "deterministic-kahan", [](Simulation& s) { CalculateForcesDeterministic(s, true); }, UpdateMT, true },
+        { "mixed", CalculateForcesMixed, UpdateMT, false },
+        { "symmetric", CalculateForcesSymmetric, UpdateMT, true },
+        { "tiled", [](Simulation& s) { CalculateForcesTiled(s); }, UpdateMT, true },
+        { "direct", [](Simulation& s) { CalculateForcesDirect<SoftenedGravity>(s.bodies, s.gravity, s.accelerations); }, UpdateMT, true },
+        { "plummer", [](Simulation& s) { CalculateForcesSIMD(s, Plummer()); }, UpdateMT, false },
+        { "cutoff", [](Simulation& s) { CalculateForcesSIMD(s, Cutoff<SoftenedGravity>()); }, UpdateMT, false },
+        { "barnes-hut", [](Simulation& s) { CalculateForcesBarnesHut(s.bodies, s.gravity); }, UpdateMT, false },
+        { "pm", [](Simulation& s) { CalculateForcesPM(s.bodies, s.gravity); }, UpdateMT, false },
+        { "p3m", [](Simulation& s) { CalculateForcesPM(s.bodies, s.gravity, 256, true); }, UpdateMT, false },
+        { "fmm", [](Simulation& s) { CalculateForcesFMM(s.bodies, s.gravity); }, UpdateMT, false },
+        { "pooled", nullptr, nullptr, true,
+            [](Simulation& s, int steps) {
+                SimulatePooled(s, steps, SharedThreadPool(omp_get_max_threads()));
+                return true;
+            } },
+        { "numa", nullptr, nullptr, true,
+            [](Simulation& s, int steps) {
+                SimulateNuma(s, steps);
+                return true;
+            } },
+        { "numa-shared", nullptr, nullptr, true,
+            [](Simulation& s, int steps) {
+                SimulateNuma(s, steps, false);
+                return true;
+            } },
+        { "distributed", nullptr, nullptr, true,
+            [](Simulation& s, int steps) {
+                return SimulateDistributed(s.bodies, s.gravity, s.deltaTime, s.width, s.height, steps);
+            } },
+        { "distributed-socket", nullptr, nullptr, true,
+            [](Simulation& s, int steps) {
+                return SimulateDistributed(s.bodies, s.gravity, s.deltaTime, s.width, s.height, steps, DISTRIBUTED_RANKS, TransportKind::Socket);
+            } },
+        { "ensemble", nullptr, nullptr, true,
+            [](Simulation& s, int steps) {
+                std::vector<std::vector<Body>> systems(1);
+                systems[0].swap(s.bodies);
+                SimulateEnsemble(systems, s.gravity, s.deltaTime, s.width, s.height, steps);
+                systems[0].swap(s.bodies);
+                return true;
+            },
+            [](std::vector<std::vector<Body>>& systems, double g, double dt, int w, int h, int steps) {
+                SimulateEnsemble(systems, g, dt, w, h, steps);
+            } },
+        { "leapfrog", nullptr, nullptr, false,
+            [](Simulation& s, int steps) {
+                SimulateFused(s.bodies, s.gravity, s.deltaTime, s.width, s.height, steps, Integrator::Leapfrog);
+                return true;
+            } },
+        { "verlet", nullptr, nullptr, false,
+            [](Simulation& s, int steps) {
+                SimulateFused(s.bodies, s.gravity, s.deltaTime, s.width, s.height, steps, Integrator::VelocityVerlet);
+                return true;
+            } },
+        { "yoshida4", nullptr, nullptr, false,
+            [](Simulation& s, int steps) {
+                SimulateFused(s.bodies, s.gravity, s.deltaTime, s.width, s.height, steps, Integrator::Yoshida4);
+                return true;
+            } },
+        { "block", nullptr, nullptr, false,
+            [](Simulation& s, int steps) {
+                SimulateBlockTimesteps(s.bodies, s.gravity, s.deltaTime, s.width, s.height, steps);
+                return true;
+            } },
+    };
+    return engines;
+}
+
+bool FindEngine(const std::string& spec, Engine& engine)
+{
+    std::string name = spec;
+    std::string param;
+    size_t colon = spec.find(':');
+    if (colon != std::string::npos) {
+        name = spec.substr(0, colon);
+        param = spec.substr(colon + 1);
+    }
+
+    for (const Engine& e : Engines()) {
+        if (e.name != name)
+            continue;
+        engine = e;
+        engine.name = spec;
+        if (param.empty())
+            return true;
+
+        char* end = nullptr;
+        double value = std::strtod(param.c_str(), &end);
+        if (end == param.c_str() || *end != '\0')
+            return false;
+        if (name == "barnes-hut")
+            engine.calc = [value](Simulation& s) { CalculateForcesBarnesHut(s.bodies, s.gravity, value); };
+        else if (name == "pm")
+            engine.calc = [value](Simulation& s) { CalculateForcesPM(s.bodies, s.gravity, (int)value); };
+        else if (name == "p3m")
+            engine.calc = [value](Simulation& s) { CalculateForcesPM(s.bodies, s.gravity, (int)value, true); };
+        else if (name == "fmm")
+            engine.calc = [value](Simulation& s) { CalculateForcesFMM(s.bodies, s.gravity, (int)value); };
+        else if (name == "cutoff") {
+            Cutoff<SoftenedGravity> law;
+            law.radius = value;
+            engine.calc = [law](Simulation& s) { CalculateForcesSIMD(s, law); };
+        } else if (name == "block") {
+            BlockTimestepConfig config;
+            config.maxLevel = (int)value;
+            engine.run = [config](Simulation& s, int steps) {
+                SimulateBlockTimesteps(s.bodies, s.gravity, s.deltaTime, s.width, s.height, steps, config);
+                return true;
+            };
+        } else if (name == "distributed" || name == "distributed-socket") {
+            TransportKind transport = name == "distributed" ? TransportKind::SharedMemory : TransportKind::Socket;
+            int ranks = (int)value;
+            engine.run = [ranks, transport](Simulation& s, int steps) {
+                return SimulateDistributed(s.bodies, s.gravity, s.deltaTime, s.width, s.height, steps, ranks, transport);
+            };
+        } else
+            return false;
+        return true;
+    }
+    return false;
+}
+
+bool RunEngine(const Engine& engine, Simulation& sim, int steps)
+{
+    if (engine.run)
+        return engine.run(sim, steps);
+    for (int s = 0; s < steps; s++) {
+        {
+            TRACE_SCOPE("force", "force");
+            engine.calc(sim);
+        }
+        {
+            TRACE_SCOPE("update", "update");
+            engine.update(sim.bodies, sim.deltaTime, sim.width, sim.height);
+        }
+    }
+    return true;
+}
+
+bool RunEngine(const Engine& engine, std::vector<Body>& bodies, double G, double deltaTime, int width, int height, int steps)
+{
+    Simulation& sim = ScratchContext();
+    sim.gravity = G;
+    sim.deltaTime = deltaTime;
+    sim.width = width;
+    sim.height = height;
+    sim.bodies.swap(bodies);
+    bool ok = RunEngine(engine, sim, steps);
+    sim.bodies.swap(bodies);
+    return ok;
+}
+
+bool RunEngineBatch(const Engine& engine, std::vector<std::vector<Body>>& systems, double G, double deltaTime, int width, int height, int steps)
+{
+    if (engine.batch) {
+        TRACE_SCOPE("batch", "force");
+        engine.batch(systems, G, deltaTime, width, height, steps);
+        return true;
+    }
+    for (std::vector<Body>& bodies : systems) {
+        if (!RunEngine(engine, bodies, G, deltaTime, width, height, steps))
+            return false;
+    }
+    return true;
+}
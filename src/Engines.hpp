@@ -0,0 +1,47 @@
+#ifndef ENGINES_HPP
+#define ENGINES_HPP
+
+#include "Body.hpp"
+#include "SimulationContext.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+
+typedef std::function<void(Simulation&)> ForceFunction;
+typedef std::function<void(std::vector<Body>&, double, int, int)> UpdateFunction;
+typedef std::function<bool(Simulation&, int)> RunFunction;
+typedef std::function<void(std::vector<std::vector<Body>>&, double, double, int, int, int)> BatchFunction;
+
+// A named force engine paired with the update pass it is normally run with.
+struct Engine {
+    std::string name;
+    ForceFunction calc;
+    UpdateFunction update;
+    // false for the approximate tree/mesh/multipole engines and for the dt-scaled
+    // integrators, whose results are not comparable with the sequential reference
+    bool exact;
+    // Engines that own the whole timestep loop set this instead of calc/update:
+    // run(sim, steps), false when the steps could not be run.
+    RunFunction run = nullptr;
+    // Engines that step many independent systems together set this as well.
+    BatchFunction batch = nullptr;
+};
+
+// Advances `steps` timesteps with the engine, whichever way it is driven.
+// Returns false if a run hook failed, in which case the bodies are unspecified.
+bool RunEngine(const Engine& engine, Simulation& sim, int steps);
+// Same, through the calling thread's scratch context.
+bool RunEngine(const Engine& engine, std::vector<Body>& bodies, double G, double deltaTime, int width, int height, int steps);
+// Advances every system; engines without a batch path step them one by one.
+bool RunEngineBatch(const Engine& engine, std::vector<std::vector<Body>>& systems, double G, double deltaTime, int width, int height, int steps);
+
+// Every engine in the order they are listed and benchmarked.
+const std::vector<Engine>& Engines();
+
+// Looks an engine up by name. Approximate engines accept their accuracy
+// parameter after a colon, e.g. "barnes-hut:0.7", "pm:512", "fmm:12",
+// "cutoff:50" for the cutoff radius and "block:6" for the deepest timestep level.
+// The distributed engines take their process count the same way, "distributed:8".
+bool FindEngine(const std::string& spec, Engine& engine);
+
+#endif // ENGINES_HPP
@@ -0,0 +1,136 @@
+#include <BodySoA.hpp>
+#include <Simulation.hpp>
+#include <algorithm>
+#include <cmath>
+
+void EnsembleBatch::Load(const std::vector<std::vector<Body>>& list)
+{
+    systems = list.size();
+    stride = (systems + ENSEMBLE_LANES - 1) / ENSEMBLE_LANES * ENSEMBLE_LANES;
+    bodies = 0;
+    counts.resize(systems);
+    for (int s = 0; s < systems; s++) {
+        counts[s] = list[s].size();
+        bodies = std::max(bodies, counts[s]);
+    }
+
+    // Padding (short systems, and the lanes past the last system) is massless
+    // and parked at the origin, so it never pulls on anything real.
+    const size_t total = (size_t)bodies * stride;
+    x.assign(total, 0.0);
+    y.assign(total, 0.0);
+    vx.assign(total, 0.0);
+    vy.assign(total, 0.0);
+    mass.assign(total, 0.0);
+
+#pragma omp parallel for
+    for (int s = 0; s < systems; s++) {
+        for (int i = 0; i < counts[s]; i++) {
+            const Body& b = list[s][i];
+            size_t k = (size_t)i * stride + s;
+            x[k] = b.position.x;
+            y[k] = b.position.y;
+            vx[k] = b.velocity.x;
+            vy[k] = b.velocity.y;
+            mass[k] = b.mass;
+        }
+    }
+}
+
+void EnsembleBatch::Store(std::vector<std::vector<Body>>& list) const
+{
+    list.resize(systems);
+
+#pragma omp parallel for
+    for (int s = 0; s < systems; s++) {
+        list[s].resize(counts[s]);
+        for (int i = 0; i < counts[s]; i++) {
+            size_t k = (size_t)i * stride + s;
+            list[s][i].position = { x[k], y[k] };
+            list[s][i].velocity = { vx[k], vy[k] };
+            list[s][i].mass = mass[k];
+        }
+    }
+}
+
+// All steps of ENSEMBLE_LANES systems starting at `first`, one system per SIMD
+// lane. The same body index of neighbouring systems is contiguous, so every
+// load in the pair loop is a full-width vector load.
+__attribute__((target_clones("avx512f", "avx2", "default"))) static void SimulateLanes(EnsembleBatch& batch, int first,
+    double G, double deltaTime, int width, int height, int steps, double* ax, double* ay)
+{
+    const int n = batch.bodies;
+    const int stride = batch.stride;
+    double* x = batch.x.data() + first;
+    double* y = batch.y.data() + first;
+    double* vx = batch.vx.data() + first;
+    double* vy = batch.vy.data() + first;
+    const double* m = batch.mass.data() + first;
+
+    for (int s = 0; s < steps; s++) {
+        for (int i = 0; i < n; i++) {
+            double axl[ENSEMBLE_LANES] = {}, ayl[ENSEMBLE_LANES] = {};
+            const double* xi = x + (size_t)i * stride;
+            const double* yi = y + (size_t)i * stride;
+            for (int j = 0; j < n; j++) {
+                const double* xj = x + (size_t)j * stride;
+                const double* yj = y + (size_t)j * stride;
+                const double* mj = m + (size_t)j * stride;
+#pragma omp simd
+                for (int l = 0; l < ENSEMBLE_LANES; l++) {
+                    double dx = xj[l] - xi[l];
+                    double dy = yj[l] - yi[l];
+                    double r2 = dx * dx + dy * dy;
+                    double f = SoftenedGravity()(r2, G * mj[l]);
+                    axl[l] += dx * f;
+                    ayl[l] += dy * f;
+                }
+            }
+            for (int l = 0; l < ENSEMBLE_LANES; l++) {
+                ax[i * ENSEMBLE_LANES + l] = axl[l];
+                ay[i * ENSEMBLE_LANES + l] = ayl[l];
+            }
+        }
+
+        // UpdateMT per lane.
+        for (int i = 0; i < n; i++) {
+            const size_t k = (size_t)i * stride;
+#pragma omp simd
+            for (int l = 0; l < ENSEMBLE_LANES; l++) {
+                double nvx = vx[k + l] + ax[i * ENSEMBLE_LANES + l];
+                double nvy = vy[k + l] + ay[i * ENSEMBLE_LANES + l];
+                if (x[k + l] < 0 || x[k + l] > width)
+                    nvx *= -1;
+                if (y[k + l] < 0 || y[k + l] > height)
+                    nvy *= -1;
+                vx[k + l] = nvx;
+                vy[k + l] = nvy;
+                x[k + l] += nvx * deltaTime;
+                y[k + l] += nvy * deltaTime;
+            }
+        }
+    }
+}
+
+void SimulateEnsemble(EnsembleBatch& batch, double G, double deltaTime, int width, int height, int steps)
+{
+    const int groups = batch.stride / ENSEMBLE_LANES;
+
+    // Groups never interact, so each thread runs whole groups for all steps
+    // with no synchronization until the end.
+#pragma omp parallel
+    {
+        std::vector<double> ax((size_t)batch.bodies * ENSEMBLE_LANES), ay(ax.size());
+#pragma omp for schedule(dynamic)
+        for (int g = 0; g < groups; g++)
+            SimulateLanes(batch, g * ENSEMBLE_LANES, G, deltaTime, width, height, steps, ax.data(), ay.data());
+    }
+}
+
+void SimulateEnsemble(std::vector<std::vector<Body>>& systems, double G, double deltaTime, int width, int height, int steps)
+{
+    EnsembleBatch batch;
+    batch.Load(systems);
+    SimulateEnsemble(batch, G, deltaTime, width, height, steps);
+    batch.Store(systems);
+}
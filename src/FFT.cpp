@@ -0,0 +1,65 @@
+#include <FFT.hpp>
+#include <cmath>
+#include <omp.h>
+#include <utility>
+
+int NextPowerOfTwo(int n)
+{
+    int p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+void FFT(std::complex<double>* data, int n, bool inverse)
+{
+    for (int i = 1, j = 0; i < n; i++) {
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            std::swap(data[i], data[j]);
+    }
+
+    for (int len = 2; len <= n; len <<= 1) {
+        double angle = 2 * M_PI / len * (inverse ? 1 : -1);
+        std::complex<double> wlen(std::cos(angle), std::sin(angle));
+        for (int i = 0; i < n; i += len) {
+            std::complex<double> w(1, 0);
+            for (int k = 0; k < len / 2; k++) {
+                std::complex<double> u = data[i + k];
+                std::complex<double> v = data[i + k + len / 2] * w;
+                data[i + k] = u + v;
+                data[i + k + len / 2] = u - v;
+                w *= wlen;
+            }
+        }
+    }
+
+    if (inverse) {
+        for (int i = 0; i < n; i++)
+            data[i] /= (double)n;
+    }
+}
+
+void FFT2D(std::vector<std::complex<double>>& data, int nx, int ny, bool inverse)
+{
+#pragma omp parallel
+    {
+#pragma omp for
+        for (int row = 0; row < ny; row++) {
+            FFT(&data[(size_t)row * nx], nx, inverse);
+        }
+
+        std::vector<std::complex<double>> column(ny);
+#pragma omp for
+        for (int col = 0; col < nx; col++) {
+            for (int row = 0; row < ny; row++)
+                column[row] = data[(size_t)row * nx + col];
+            FFT(column.data(), ny, inverse);
+            for (int row = 0; row < ny; row++)
+                data[(size_t)row * nx + col] = column[row];
+        }
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef FFT_HPP
+#define FFT_HPP
+
+#include <complex>
+#include <vector>
+
+// In-place iterative radix-2 FFT. n must be a power of two; the inverse
+// transform is scaled by 1 / n.
+void FFT(std::complex<double>* data, int n, bool inverse);
+
+// Row-major nx * ny transform, rows and columns each done in parallel.
+void FFT2D(std::vector<std::complex<double>>& data, int nx, int ny, bool inverse);
+
+int NextPowerOfTwo(int n);
+
+#endif // FFT_HPP
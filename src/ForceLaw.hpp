@@ -0,0 +1,85 @@
+#ifndef FORCE_LAW_HPP
+#define FORCE_LAW_HPP
+
+#include "Body.hpp"
+#include <cmath>
+#include <vector>
+
+// Force laws as policies: each returns the factor s for which the acceleration
+// on body i from body j is s * (x_j - x_i), given r^2 and G * m_j. Engines take
+// the law as a template parameter, so the call is inlined into the pair loop.
+
+// The law every engine in Simulation.hpp uses: G * m / ((r^2 + eps) * r).
+struct SoftenedGravity {
+    template <typename T>
+    T operator()(T r2, T Gm) const
+    {
+        return r2 < T(0.000001 * 0.000001) ? T(0) : Gm / ((r2 + T(SOFTENING)) * std::sqrt(r2));
+    }
+};
+
+// Plummer-softened gravity, G * m / (r^2 + eps)^(3/2); smooth at r = 0.
+struct Plummer {
+    template <typename T>
+    T operator()(T r2, T Gm) const
+    {
+        T s = r2 + T(SOFTENING);
+        return Gm / (s * std::sqrt(s));
+    }
+};
+
+// Wraps another law and drops pairs farther apart than radius.
+template <typename Law>
+struct Cutoff {
+    double radius = 100;
+    Law law;
+
+    template <typename T>
+    T operator()(T r2, T Gm) const
+    {
+        return r2 > T(radius * radius) ? T(0) : law(r2, Gm);
+    }
+};
+
+// All-pairs kick, v += a, in any dimension and with any law. accelerations is
+// scratch, sized here, so a caller stepping repeatedly keeps one buffer.
+template <typename Law, typename T, int D>
+void CalculateForcesDirect(std::vector<BodyT<T, D>>& bodies, T G, std::vector<Vec<T, D>>& accelerations, const Law& law = Law())
+{
+    const int n = bodies.size();
+    accelerations.resize(n);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < n; i++) {
+        const Vec<T, D> pi = bodies[i].position;
+        Vec<T, D> acc;
+        for (int j = 0; j < n; j++) {
+            Vec<T, D> d = sub(bodies[j].position, pi);
+            acc = add(acc, scale(d, law(dot(d, d), G * bodies[j].mass)));
+        }
+        accelerations[i] = acc;
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < n; i++)
+        bodies[i].velocity = add(bodies[i].velocity, accelerations[i]);
+}
+
+// UpdateMT for any dimension: reflect off [0, extent] on each axis, then drift.
+template <typename T, int D>
+void UpdateDirect(std::vector<BodyT<T, D>>& bodies, T deltaTime, Vec<T, D> extent)
+{
+    const int n = bodies.size();
+
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        BodyT<T, D>& b = bodies[i];
+        for (int k = 0; k < D; k++) {
+            if (b.position[k] < 0 || b.position[k] > extent[k])
+                b.velocity[k] *= -1;
+        }
+        b.position = add(b.position, scale(b.velocity, deltaTime));
+    }
+}
+
+#endif // FORCE_LAW_HPP
@@ -0,0 +1,140 @@
+#include <BodySoA.hpp>
+#include <Simulation.hpp>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+static const int FUSED_CHUNK = 16;
+
+// One pass over all bodies: accelerations at `cur` positions, kick by
+// kick * a * dt, reflect off the domain edges as UpdateMT does, then drift by
+// drift * v * dt into `next`. Reads only `cur` positions, so it needs no
+// barrier between the force and integration halves. Reflection belongs to the
+// drift it precedes, so a closing half-kick (drift 0) never reflects and a
+// step split across calls reflects once. Without forces set, ax/ay already
+// hold the accelerations at `cur`.
+static void FusedSweep(BodySoA& cur, BodySoA& next, AlignedVector<double>& ax, AlignedVector<double>& ay,
+    double G, double deltaTime, int width, int height, double kick, double drift, bool forces = true)
+{
+    const int n = cur.size();
+
+#pragma omp parallel for schedule(dynamic)
+    for (int begin = 0; begin < n; begin += FUSED_CHUNK) {
+        int end = begin + FUSED_CHUNK < n ? begin + FUSED_CHUNK : n;
+        if (forces) {
+            for (int i = begin; i < end; i++) {
+                ax[i] = 0;
+                ay[i] = 0;
+            }
+            AccumulateAccelerationsSIMD(cur, begin, end, G, ax.data(), ay.data());
+        }
+
+        for (int i = begin; i < end; i++) {
+            double vx = cur.vx[i] + kick * ax[i] * deltaTime;
+            double vy = cur.vy[i] + kick * ay[i] * deltaTime;
+            if (drift != 0 && (cur.x[i] < 0 || cur.x[i] > width))
+                vx *= -1;
+            if (drift != 0 && (cur.y[i] < 0 || cur.y[i] > height))
+                vy *= -1;
+            next.vx[i] = vx;
+            next.vy[i] = vy;
+            next.x[i] = cur.x[i] + drift * vx * deltaTime;
+            next.y[i] = cur.y[i] + drift * vy * deltaTime;
+        }
+    }
+
+    std::swap(cur, next);
+}
+
+static void Drift(BodySoA& soa, double deltaTime, double drift)
+{
+    const int n = soa.size();
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        soa.x[i] += drift * soa.vx[i] * deltaTime;
+        soa.y[i] += drift * soa.vy[i] * deltaTime;
+    }
+}
+
+bool FusedState::Matches(const BodySoA& soa) const
+{
+    const size_t bytes = soa.x.size() * sizeof(double);
+    return x.size() == soa.x.size() && std::memcmp(x.data(), soa.x.data(), bytes) == 0 && std::memcmp(y.data(), soa.y.data(), bytes) == 0;
+}
+
+void SimulateFused(std::vector<Body>& bodies, double G, double deltaTime, int width, int height, int steps, Integrator integrator,
+    FusedState* state)
+{
+    const int n = bodies.size();
+    if (n == 0 || steps <= 0)
+        return;
+
+    FusedState local;
+    FusedState& buffers = state ? *state : local;
+    BodySoA& cur = buffers.cur;
+    BodySoA& next = buffers.next;
+    cur.Load(bodies);
+    next.Resize(n);
+    next.mass = cur.mass;
+    AlignedVector<double>& ax = buffers.ax;
+    AlignedVector<double>& ay = buffers.ay;
+    const bool cached = state && state->Matches(cur);
+    ax.resize(n);
+    ay.resize(n);
+
+    // Adjacent half-drifts (or half-kicks) of consecutive steps are merged into
+    // the same sweep, so every force evaluation costs exactly one pass.
+    switch (integrator) {
+    case Integrator::Leapfrog:
+        // Drift-kick-drift.
+        Drift(cur, deltaTime, 0.5);
+        for (int s = 0; s < steps; s++)
+            FusedSweep(cur, next, ax, ay, G, deltaTime, width, height, 1.0, s + 1 < steps ? 1.0 : 0.5);
+        break;
+
+    case Integrator::VelocityVerlet:
+        // Kick-drift-kick; velocities and positions stay synchronized. The
+        // opening half-kick reuses the previous call's closing accelerations
+        // when they were taken at these positions.
+        FusedSweep(cur, next, ax, ay, G, deltaTime, width, height, 0.5, 1.0, !cached);
+        for (int s = 1; s < steps; s++)
+            FusedSweep(cur, next, ax, ay, G, deltaTime, width, height, 1.0, 1.0);
+        FusedSweep(cur, next, ax, ay, G, deltaTime, width, height, 0.5, 0.0);
+        if (state) {
+            state->x = cur.x;
+            state->y = cur.y;
+        }
+        break;
+
+    case Integrator::Yoshida4: {
+        // Fourth-order composition of three drift-kick-drift substeps.
+        const double cbrt2 = std::cbrt(2.0);
+        const double w1 = 1 / (2 - cbrt2);
+        const double w0 = -cbrt2 * w1;
+        const double c1 = w1 / 2, c2 = (w0 + w1) / 2;
+
+        Drift(cur, deltaTime, c1);
+        for (int s = 0; s < steps; s++) {
+            FusedSweep(cur, next, ax, ay, G, deltaTime, width, height, w1, c2);
+            FusedSweep(cur, next, ax, ay, G, deltaTime, width, height, w0, c2);
+            FusedSweep(cur, next, ax, ay, G, deltaTime, width, height, w1, s + 1 < steps ? 2 * c1 : c1);
+        }
+        break;
+    }
+    }
+
+    cur.Store(bodies);
+}
+
+bool ParseIntegrator(const std::string& name, Integrator& integrator)
+{
+    if (name == "leapfrog")
+        integrator = Integrator::Leapfrog;
+    else if (name == "verlet")
+        integrator = Integrator::VelocityVerlet;
+    else if (name == "yoshida4")
+        integrator = Integrator::Yoshida4;
+    else
+        return false;
+    return true;
+}
@@ -0,0 +1,132 @@
+#include <InitialConditions.hpp>
+#include <Random.hpp>
+#include <algorithm>
+#include <cmath>
+
+static const double MIN_MASS = 10;
+static const double MAX_MASS = 100;
+static const double MEAN_MASS = (MIN_MASS + MAX_MASS) / 2;
+// Plummer radii are truncated here, in units of the scale radius.
+static const double PLUMMER_CUTOFF = 10;
+
+bool ParseDistribution(const std::string& name, Distribution& distribution)
+{
+    if (name == "uniform")
+        distribution = Distribution::Uniform;
+    else if (name == "plummer")
+        distribution = Distribution::Plummer;
+    else if (name == "disk")
+        distribution = Distribution::Disk;
+    else if (name == "clusters")
+        distribution = Distribution::Clusters;
+    else
+        return false;
+    return true;
+}
+
+// Isotropic unit vector in 3D, projected onto the plane.
+static Vec2 ProjectedDirection(Philox& rng)
+{
+    double z = rng.Uniform(-1, 1);
+    double phi = rng.Uniform(0, 2 * M_PI);
+    double s = std::sqrt(1 - z * z);
+    return { s * std::cos(phi), s * std::sin(phi) };
+}
+
+// One body of a Plummer sphere of total mass M and scale radius a (Aarseth,
+// Henon & Wielen 1974): radius from the inverse cumulative mass, speed by
+// rejection from q^2 (1 - q^2)^3.5 times the local escape speed.
+static void SamplePlummer(Philox& rng, double G, double M, double a, Vec2 center, Vec2 drift, Body& b)
+{
+    double r;
+    do {
+        double u = 1.0 - rng.Uniform();
+        r = a / std::sqrt(std::pow(u, -2.0 / 3.0) - 1);
+    } while (r > PLUMMER_CUTOFF * a);
+
+    double q, g;
+    do {
+        q = rng.Uniform();
+        g = rng.Uniform(0, 0.1);
+    } while (g > q * q * std::pow(1 - q * q, 3.5));
+    double escape = std::sqrt(2 * G * M / a) * std::pow(1 + r * r / (a * a), -0.25);
+
+    b.position = add(center, scale(ProjectedDirection(rng), r));
+    b.velocity = add(drift, scale(ProjectedDirection(rng), q * escape));
+}
+
+std::vector<Body> GenerateBodies(int n, const InitialConditions& ic)
+{
+    std::vector<Body> bodies(n);
+    const double G = ic.engineStep > 0 ? ic.gravity / ic.engineStep : ic.gravity;
+    const Vec2 center = { ic.width / 2.0, ic.height / 2.0 };
+    const double extent = std::min(ic.width, ic.height);
+
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        Philox rng(ic.seed, i);
+        Body& b = bodies[i];
+        b.mass = rng.Uniform(MIN_MASS, MAX_MASS);
+        b.velocity = { 0, 0 };
+
+        switch (ic.distribution) {
+        case Distribution::Uniform:
+            b.position = { rng.Uniform(100, ic.width - 100), rng.Uniform(100, ic.height - 100) };
+            break;
+
+        case Distribution::Plummer:
+            SamplePlummer(rng, G, MEAN_MASS * n, extent / 10, center, { 0, 0 }, b);
+            break;
+
+        case Distribution::Disk: {
+            // Uniform surface density between inner and outer radius, on circular
+            // orbits under the softened law around the central mass plus the
+            // disk mass inside r.
+            const double inner = extent / 20, outer = extent * 0.45;
+            const double diskMass = MEAN_MASS * (n - 1);
+            if (i == 0) {
+                b.mass = diskMass;
+                b.position = center;
+                break;
+            }
+            double f = rng.Uniform();
+            double r = std::sqrt(inner * inner + f * (outer * outer - inner * inner));
+            double phi = rng.Uniform(0, 2 * M_PI);
+            double speed = std::sqrt(G * (diskMass + f * diskMass) * r / (r * r + SOFTENING));
+            b.position = { center.x + r * std::cos(phi), center.y + r * std::sin(phi) };
+            b.velocity = { -speed * std::sin(phi), speed * std::cos(phi) };
+            break;
+        }
+
+        case Distribution::Clusters: {
+            // Equal halves a fifth of the frame either side of centre, offset by
+            // one scale radius vertically, approaching below escape speed.
+            const double a = extent / 16;
+            const double half = MEAN_MASS * n / 2;
+            const double separation = ic.width * 0.4;
+            const double approach = 0.5 * std::sqrt(G * 2 * half / separation);
+            const int side = i < n / 2 ? -1 : 1;
+            Vec2 c = { center.x + side * separation / 2, center.y + side * a };
+            SamplePlummer(rng, G, half, a, c, { -side * approach / 2, 0 }, b);
+            break;
+        }
+        }
+    }
+    return bodies;
+}
+
+std::vector<Body3> GenerateBodies3(int n, const InitialConditions& ic, double depth)
+{
+    std::vector<Body> planar = GenerateBodies(n, ic);
+    std::vector<Body3> bodies(n);
+
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        Philox rng(ic.seed + 1, i);
+        const Body& p = planar[i];
+        bodies[i].position = { p.position.x, p.position.y, depth / 2 + rng.Uniform(-depth / 20, depth / 20) };
+        bodies[i].velocity = { p.velocity.x, p.velocity.y, 0 };
+        bodies[i].mass = p.mass;
+    }
+    return bodies;
+}
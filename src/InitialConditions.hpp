@@ -0,0 +1,38 @@
+#ifndef INITIAL_CONDITIONS_HPP
+#define INITIAL_CONDITIONS_HPP
+
+#include "Body.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class Distribution {
+    Uniform, // masses 10-100 at rest, uniform in the frame minus a 100px border
+    Plummer, // Plummer sphere in virial equilibrium, projected onto the plane
+    Disk, // rotating Keplerian disk around a central mass (body 0)
+    Clusters, // two Plummer spheres on a collision course
+};
+bool ParseDistribution(const std::string& name, Distribution& distribution);
+
+struct InitialConditions {
+    Distribution distribution = Distribution::Uniform;
+    uint64_t seed = 1;
+    double gravity = 9.8; // sets the equilibrium velocities
+    // The force engines kick v += a once per step of this length rather than
+    // v += a dt, which acts like gravity / engineStep; velocities are scaled to
+    // match. Leave 0 for the integrators, which apply v += a dt.
+    double engineStep = 0;
+    int width = 1920;
+    int height = 1080;
+};
+
+// Body i draws only from Philox stream i of the seed, so the result is
+// bit-identical for any thread count. For the uniform distribution body i is
+// also the same for any n' >= i; the others scale mass and split clusters by n.
+std::vector<Body> GenerateBodies(int n, const InitialConditions& ic);
+// The planar distribution thickened into a slab of the given depth: each body
+// keeps its 2D state and gets a z within depth / 20 of the mid plane, drawn
+// from stream i of seed + 1 so the planar part stays as above.
+std::vector<Body3> GenerateBodies3(int n, const InitialConditions& ic, double depth);
+
+#endif // INITIAL_CONDITIONS_HPP
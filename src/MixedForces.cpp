@@ -0,0 +1,218 @@
+#include <BodySoA.hpp>
+#include <Simulation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+#include <omp.h>
+
+// Bodies per j-tile. Each tile gets its own float origin and its own float
+// partial sums, which are folded into double once per tile.
+static const int MIXED_TILE = 256;
+static const float MIN_DIST_SQRD_F = 1e-12f;
+
+// Float copy of the j-side of the pair loop: positions relative to the
+// centroid of their tile, and G * m. Tiles are padded with massless bodies.
+struct MixedTiles {
+    int tiles = 0;
+    float* x = nullptr;
+    float* y = nullptr;
+    float* gm = nullptr;
+    double* originX = nullptr;
+    double* originY = nullptr;
+};
+
+typedef void (*MixedKernel)(const MixedTiles&, const double*, const double*, int, int, double*, double*);
+
+static void BuildTiles(const BodySoA& soa, double G, ScratchArena& arena, MixedTiles& t)
+{
+    const int n = soa.size();
+    t.tiles = (n + MIXED_TILE - 1) / MIXED_TILE;
+    const int padded = t.tiles * MIXED_TILE;
+    t.x = arena.Allocate<float>(padded);
+    t.y = arena.Allocate<float>(padded);
+    t.gm = arena.Allocate<float>(padded);
+    t.originX = arena.Allocate<double>(t.tiles);
+    t.originY = arena.Allocate<double>(t.tiles);
+    for (int j = n; j < padded; j++) {
+        t.x[j] = 0.0f;
+        t.y[j] = 0.0f;
+        t.gm[j] = 0.0f;
+    }
+
+#pragma omp parallel for
+    for (int k = 0; k < t.tiles; k++) {
+        const int begin = k * MIXED_TILE;
+        const int end = begin + MIXED_TILE < n ? begin + MIXED_TILE : n;
+        double ox = 0, oy = 0;
+        for (int j = begin; j < end; j++) {
+            ox += soa.x[j];
+            oy += soa.y[j];
+        }
+        ox /= end - begin;
+        oy /= end - begin;
+        t.originX[k] = ox;
+        t.originY[k] = oy;
+        for (int j = begin; j < end; j++) {
+            t.x[j] = (float)(soa.x[j] - ox);
+            t.y[j] = (float)(soa.y[j] - oy);
+            t.gm[j] = (float)(G * soa.mass[j]);
+        }
+    }
+}
+
+// Scalar reference; 1 / ((r^2 + eps) * r) is taken as one rsqrt of (r^2 + eps)^2 * r^2.
+static void MixedScalar(const MixedTiles& t, const double* x, const double* y, int begin, int end, double* ax, double* ay)
+{
+    const float eps = (float)SOFTENING;
+
+    for (int i = begin; i < end; i++) {
+        double axi = 0, ayi = 0;
+        for (int k = 0; k < t.tiles; k++) {
+            const float xi = (float)(x[i] - t.originX[k]);
+            const float yi = (float)(y[i] - t.originY[k]);
+            const int base = k * MIXED_TILE;
+            float axt = 0, ayt = 0;
+
+#pragma omp simd reduction(+ : axt, ayt)
+            for (int j = base; j < base + MIXED_TILE; j++) {
+                float dx = t.x[j] - xi;
+                float dy = t.y[j] - yi;
+                float r2 = dx * dx + dy * dy;
+                float s2 = r2 + eps;
+                float s = r2 < MIN_DIST_SQRD_F ? 0.0f : t.gm[j] / std::sqrt(s2 * s2 * r2);
+                axt += dx * s;
+                ayt += dy * s;
+            }
+            axi += axt;
+            ayi += ayt;
+        }
+        ax[i] += axi;
+        ay[i] += ayi;
+    }
+}
+
+__attribute__((target("avx2,fma"))) static void MixedAVX2(const MixedTiles& t, const double* x, const double* y, int begin, int end, double* ax, double* ay)
+{
+    const __m256 vEps = _mm256_set1_ps((float)SOFTENING);
+    const __m256 vMin = _mm256_set1_ps(MIN_DIST_SQRD_F);
+    const __m256 vHalf = _mm256_set1_ps(0.5f);
+    const __m256 vThreeHalves = _mm256_set1_ps(1.5f);
+
+    for (int i = begin; i < end; i++) {
+        double axi = 0, ayi = 0;
+        for (int k = 0; k < t.tiles; k++) {
+            const __m256 xi = _mm256_set1_ps((float)(x[i] - t.originX[k]));
+            const __m256 yi = _mm256_set1_ps((float)(y[i] - t.originY[k]));
+            const int base = k * MIXED_TILE;
+            __m256 axt = _mm256_setzero_ps();
+            __m256 ayt = _mm256_setzero_ps();
+
+            for (int j = base; j < base + MIXED_TILE; j += 8) {
+                __m256 dx = _mm256_sub_ps(_mm256_load_ps(&t.x[j]), xi);
+                __m256 dy = _mm256_sub_ps(_mm256_load_ps(&t.y[j]), yi);
+                __m256 r2 = _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dx, dx));
+                __m256 s2 = _mm256_add_ps(r2, vEps);
+                __m256 q = _mm256_mul_ps(_mm256_mul_ps(s2, s2), r2);
+
+                // rsqrt estimate plus one Newton step: y * (1.5 - 0.5 * q * y^2)
+                __m256 r = _mm256_rsqrt_ps(q);
+                r = _mm256_mul_ps(r, _mm256_fnmadd_ps(_mm256_mul_ps(vHalf, q), _mm256_mul_ps(r, r), vThreeHalves));
+
+                __m256 s = _mm256_mul_ps(_mm256_load_ps(&t.gm[j]), r);
+                s = _mm256_and_ps(s, _mm256_cmp_ps(r2, vMin, _CMP_GE_OQ));
+                axt = _mm256_fmadd_ps(dx, s, axt);
+                ayt = _mm256_fmadd_ps(dy, s, ayt);
+            }
+
+            alignas(32) float sx[8], sy[8];
+            _mm256_store_ps(sx, axt);
+            _mm256_store_ps(sy, ayt);
+            for (int l = 0; l < 8; l++) {
+                axi += sx[l];
+                ayi += sy[l];
+            }
+        }
+        ax[i] += axi;
+        ay[i] += ayi;
+    }
+}
+
+__attribute__((target("avx512f"))) static void MixedAVX512(const MixedTiles& t, const double* x, const double* y, int begin, int end, double* ax, double* ay)
+{
+    const __m512 vEps = _mm512_set1_ps((float)SOFTENING);
+    const __m512 vMin = _mm512_set1_ps(MIN_DIST_SQRD_F);
+    const __m512 vHalf = _mm512_set1_ps(0.5f);
+    const __m512 vThreeHalves = _mm512_set1_ps(1.5f);
+
+    for (int i = begin; i < end; i++) {
+        double axi = 0, ayi = 0;
+        for (int k = 0; k < t.tiles; k++) {
+            const __m512 xi = _mm512_set1_ps((float)(x[i] - t.originX[k]));
+            const __m512 yi = _mm512_set1_ps((float)(y[i] - t.originY[k]));
+            const int base = k * MIXED_TILE;
+            __m512 axt = _mm512_setzero_ps();
+            __m512 ayt = _mm512_setzero_ps();
+
+            for (int j = base; j < base + MIXED_TILE; j += 16) {
+                __m512 dx = _mm512_sub_ps(_mm512_load_ps(&t.x[j]), xi);
+                __m512 dy = _mm512_sub_ps(_mm512_load_ps(&t.y[j]), yi);
+                __m512 r2 = _mm512_fmadd_ps(dy, dy, _mm512_mul_ps(dx, dx));
+                __m512 s2 = _mm512_add_ps(r2, vEps);
+                __m512 q = _mm512_mul_ps(_mm512_mul_ps(s2, s2), r2);
+
+                __m512 r = _mm512_rsqrt14_ps(q);
+                r = _mm512_mul_ps(r, _mm512_fnmadd_ps(_mm512_mul_ps(vHalf, q), _mm512_mul_ps(r, r), vThreeHalves));
+
+                __m512 s = _mm512_mul_ps(_mm512_load_ps(&t.gm[j]), r);
+                __mmask16 near = _mm512_cmp_ps_mask(r2, vMin, _CMP_GE_OQ);
+                axt = _mm512_mask3_fmadd_ps(dx, s, axt, near);
+                ayt = _mm512_mask3_fmadd_ps(dy, s, ayt, near);
+            }
+
+            axi += _mm512_reduce_add_ps(axt);
+            ayi += _mm512_reduce_add_ps(ayt);
+        }
+        ax[i] += axi;
+        ay[i] += ayi;
+    }
+}
+
+static MixedKernel SelectMixedKernel()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return MixedAVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return MixedAVX2;
+    return MixedScalar;
+}
+
+void CalculateForcesMixed(Simulation& sim)
+{
+    static const MixedKernel kernel = SelectMixedKernel();
+    sim.BeginStep();
+    std::vector<Body>& bodies = sim.bodies;
+    const int n = bodies.size();
+
+    BodySoA& soa = sim.soa;
+    soa.Load(bodies);
+    MixedTiles tiles;
+    BuildTiles(soa, sim.gravity, sim.Arena(0), tiles);
+    AlignedVector<double>& ax = sim.ax;
+    AlignedVector<double>& ay = sim.ay;
+    std::fill(ax.begin(), ax.end(), 0.0);
+    std::fill(ay.begin(), ay.end(), 0.0);
+    const int chunk = 16;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int begin = 0; begin < n; begin += chunk) {
+        int end = begin + chunk < n ? begin + chunk : n;
+        kernel(tiles, soa.x.data(), soa.y.data(), begin, end, ax.data(), ay.data());
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        bodies[i].velocity.x += ax[i];
+        bodies[i].velocity.y += ay[i];
+    }
+}
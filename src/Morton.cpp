@@ -0,0 +1,118 @@
+#include <Morton.hpp>
+#include <algorithm>
+#include <numeric>
+#include <omp.h>
+
+static const int RADIX_BITS = 8;
+static const int RADIX = 1 << RADIX_BITS;
+
+void RadixSortByKey(std::vector<uint32_t>& keys, std::vector<int>& values)
+{
+    const int n = keys.size();
+    std::vector<uint32_t> keysOut(n);
+    std::vector<int> valuesOut(n);
+    std::vector<size_t> offsets((size_t)omp_get_max_threads() * RADIX);
+
+    for (int shift = 0; shift < 32; shift += RADIX_BITS) {
+#pragma omp parallel
+        {
+            const int t = omp_get_thread_num();
+            const int threads = omp_get_num_threads();
+            const int begin = (int)((long)n * t / threads);
+            const int end = (int)((long)n * (t + 1) / threads);
+            size_t* own = &offsets[(size_t)t * RADIX];
+
+            std::fill(own, own + RADIX, 0);
+            for (int i = begin; i < end; i++)
+                own[(keys[i] >> shift) & (RADIX - 1)]++;
+#pragma omp barrier
+
+            // Digit-major, thread-minor exclusive scan: thread t's keys with digit
+            // d land after every lower digit and after threads < t with digit d.
+#pragma omp single
+            {
+                size_t running = 0;
+                for (int d = 0; d < RADIX; d++) {
+                    for (int s = 0; s < threads; s++) {
+                        size_t count = offsets[(size_t)s * RADIX + d];
+                        offsets[(size_t)s * RADIX + d] = running;
+                        running += count;
+                    }
+                }
+            }
+
+            for (int i = begin; i < end; i++) {
+                size_t slot = own[(keys[i] >> shift) & (RADIX - 1)]++;
+                keysOut[slot] = keys[i];
+                valuesOut[slot] = values[i];
+            }
+        }
+        keys.swap(keysOut);
+        values.swap(valuesOut);
+    }
+}
+
+void ComputeMortonKeys(const std::vector<Body>& bodies, std::vector<uint32_t>& keys)
+{
+    const int n = bodies.size();
+    keys.resize(n);
+    if (n == 0)
+        return;
+
+    double minx = bodies[0].position.x, maxx = minx;
+    double miny = bodies[0].position.y, maxy = miny;
+#pragma omp parallel for reduction(min : minx, miny) reduction(max : maxx, maxy)
+    for (int i = 0; i < n; i++) {
+        minx = std::min(minx, bodies[i].position.x);
+        maxx = std::max(maxx, bodies[i].position.x);
+        miny = std::min(miny, bodies[i].position.y);
+        maxy = std::max(maxy, bodies[i].position.y);
+    }
+
+    const double size = std::max(std::max(maxx - minx, maxy - miny), 1e-9);
+    const double toCell = 65535.0 / size;
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        uint32_t ix = (uint32_t)((bodies[i].position.x - minx) * toCell);
+        uint32_t iy = (uint32_t)((bodies[i].position.y - miny) * toCell);
+        keys[i] = MortonKey(ix, iy);
+    }
+}
+
+void ReorderMorton(std::vector<Body>& bodies, std::vector<int>& ids)
+{
+    const int n = bodies.size();
+    if ((int)ids.size() != n) {
+        ids.resize(n);
+        std::iota(ids.begin(), ids.end(), 0);
+    }
+
+    std::vector<uint32_t> keys;
+    ComputeMortonKeys(bodies, keys);
+    std::vector<int> perm(n);
+    std::iota(perm.begin(), perm.end(), 0);
+    RadixSortByKey(keys, perm);
+
+    std::vector<Body> sorted(n);
+    std::vector<int> sortedIds(n);
+#pragma omp parallel for
+    for (int k = 0; k < n; k++) {
+        sorted[k] = bodies[perm[k]];
+        sortedIds[k] = ids[perm[k]];
+    }
+    bodies.swap(sorted);
+    ids.swap(sortedIds);
+}
+
+void RestoreOriginalOrder(const std::vector<Body>& bodies, const std::vector<int>& ids, std::vector<Body>& out)
+{
+    const int n = bodies.size();
+    out.resize(n);
+    if ((int)ids.size() != n) {
+        out = bodies;
+        return;
+    }
+#pragma omp parallel for
+    for (int k = 0; k < n; k++)
+        out[ids[k]] = bodies[k];
+}
@@ -0,0 +1,39 @@
+#ifndef MORTON_HPP
+#define MORTON_HPP
+
+#include "Body.hpp"
+#include <cstdint>
+#include <vector>
+
+// Spreads the low 16 bits of v so they occupy the even bit positions.
+inline uint32_t SpreadBits(uint32_t v)
+{
+    v &= 0x0000ffff;
+    v = (v | (v << 8)) & 0x00ff00ff;
+    v = (v | (v << 4)) & 0x0f0f0f0f;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+// Z-order key of a cell on a 2^16 x 2^16 grid, x in the even bits.
+inline uint32_t MortonKey(uint32_t ix, uint32_t iy)
+{
+    return SpreadBits(ix) | (SpreadBits(iy) << 1);
+}
+
+// Parallel LSD radix sort, 8 bits per pass. Stable, so values with equal keys
+// keep their relative order; values are permuted along with the keys.
+void RadixSortByKey(std::vector<uint32_t>& keys, std::vector<int>& values);
+
+// Morton keys of the positions on a grid spanning their bounding box.
+void ComputeMortonKeys(const std::vector<Body>& bodies, std::vector<uint32_t>& keys);
+
+// Sorts bodies into Z-order. ids[k] is the original index of the body in slot
+// k; it is filled with 0..n-1 when empty and permuted along with the bodies.
+void ReorderMorton(std::vector<Body>& bodies, std::vector<int>& ids);
+
+// Writes bodies back in original index order: out[ids[k]] = bodies[k].
+void RestoreOriginalOrder(const std::vector<Body>& bodies, const std::vector<int>& ids, std::vector<Body>& out);
+
+#endif // MORTON_HPP
@@ -0,0 +1,335 @@
+#include <Simulation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+
+// Fast multipole method on a uniform quadtree.
+//
+// The pair force used throughout the repo falls off as 1/r^2, which is the
+// gradient of the 3D Laplace potential 1/r evaluated in the plane, not the 2D
+// log potential. So instead of complex log expansions, the expansions here are
+// Cartesian Taylor series of 1/r in the two in-plane coordinates. A coefficient
+// with multi-index (a, b) multiplies x^a y^b and only terms with a + b <= order
+// are kept.
+
+namespace {
+
+const int LEAF_TARGET = 32; // average bodies per leaf the depth is chosen for
+const int MAX_LEVEL = 10;
+
+struct Expansions {
+    int order;
+    int terms;
+    std::vector<int> index; // (a, b) -> flat index
+    std::vector<double> binom; // binom[n * (order + 1) + k]
+
+    explicit Expansions(int p)
+        : order(p)
+        , terms((p + 1) * (p + 2) / 2)
+        , index((p + 1) * (p + 1), -1)
+        , binom((p + 1) * (p + 1), 0.0)
+    {
+        for (int n = 0; n <= p; n++) {
+            for (int b = 0; b <= n; b++)
+                index[(n - b) * (p + 1) + b] = n * (n + 1) / 2 + b;
+            binom[n * (p + 1)] = 1;
+            for (int k = 1; k <= n; k++)
+                binom[n * (p + 1) + k] = binom[(n - 1) * (p + 1) + k - 1] + (k < n ? binom[(n - 1) * (p + 1) + k] : 0);
+        }
+    }
+
+    int At(int a, int b) const { return index[a * (order + 1) + b]; }
+    double Choose(int n, int k) const { return binom[n * (order + 1) + k]; }
+
+    // Powers x^a y^b for every kept multi-index, each one multiplication from a
+    // term of the previous degree, so nothing is allocated per call.
+    void Powers(double x, double y, double* out) const
+    {
+        out[At(0, 0)] = 1;
+        for (int n = 1; n <= order; n++) {
+            out[At(n, 0)] = out[At(n - 1, 0)] * x;
+            for (int b = 1; b <= n; b++)
+                out[At(n - b, b)] = out[At(n - b, b - 1)] * y;
+        }
+    }
+
+    // Taylor coefficients D^k(1/r) / k! at (x, y), from the recurrence
+    // n r^2 T_k = -(2n - 1) sum_i x_i T_{k - e_i} - (n - 1) sum_i T_{k - 2e_i}.
+    void Derivatives(double x, double y, double* T) const
+    {
+        double r2 = x * x + y * y;
+        T[0] = 1 / std::sqrt(r2);
+        for (int n = 1; n <= order; n++) {
+            for (int b = 0; b <= n; b++) {
+                int a = n - b;
+                double sum = 0;
+                if (a >= 1)
+                    sum += (2 * n - 1) * x * T[At(a - 1, b)];
+                if (b >= 1)
+                    sum += (2 * n - 1) * y * T[At(a, b - 1)];
+                if (a >= 2)
+                    sum += (n - 1) * T[At(a - 2, b)];
+                if (b >= 2)
+                    sum += (n - 1) * T[At(a, b - 2)];
+                T[At(a, b)] = -sum / (n * r2);
+            }
+        }
+    }
+};
+
+struct Level {
+    int side; // cells per side
+    int offset; // first cell of this level in the flat arrays
+};
+
+struct Grid {
+    int depth;
+    double originX, originY;
+    double size; // side length of the root cell
+    std::vector<Level> levels;
+    int cellCount = 0;
+
+    double Width(int level) const { return size / levels[level].side; }
+    double CenterX(int level, int ix) const { return originX + (ix + 0.5) * Width(level); }
+    double CenterY(int level, int iy) const { return originY + (iy + 0.5) * Width(level); }
+    int Cell(int level, int ix, int iy) const { return levels[level].offset + iy * levels[level].side + ix; }
+};
+
+} // namespace
+
+void CalculateForcesFMM(std::vector<Body>& bodies, double G, int order)
+{
+    const int n = bodies.size();
+    if (n == 0)
+        return;
+
+    order = std::max(order, 1);
+    const Expansions ex(order);
+    const int P = ex.terms;
+
+    Grid grid;
+    double minx = bodies[0].position.x, maxx = minx;
+    double miny = bodies[0].position.y, maxy = miny;
+#pragma omp parallel for reduction(min : minx, miny) reduction(max : maxx, maxy)
+    for (int i = 0; i < n; i++) {
+        minx = std::min(minx, bodies[i].position.x);
+        maxx = std::max(maxx, bodies[i].position.x);
+        miny = std::min(miny, bodies[i].position.y);
+        maxy = std::max(maxy, bodies[i].position.y);
+    }
+    grid.size = std::max(std::max(maxx - minx, maxy - miny), 1e-9) * (1 + 1e-9);
+    grid.originX = minx;
+    grid.originY = miny;
+
+    grid.depth = 2;
+    while (grid.depth < MAX_LEVEL && (double)n / (1 << (2 * grid.depth)) > LEAF_TARGET)
+        grid.depth++;
+    for (int l = 0; l <= grid.depth; l++) {
+        grid.levels.push_back({ 1 << l, grid.cellCount });
+        grid.cellCount += 1 << (2 * l);
+    }
+
+    // Counting sort of bodies into leaves.
+    const int leafLevel = grid.depth;
+    const int leafSide = grid.levels[leafLevel].side;
+    const int leaves = leafSide * leafSide;
+    std::vector<int> leafOf(n), start(leaves + 1, 0), sorted(n);
+    for (int i = 0; i < n; i++) {
+        int ix = std::min(leafSide - 1, (int)((bodies[i].position.x - grid.originX) / grid.Width(leafLevel)));
+        int iy = std::min(leafSide - 1, (int)((bodies[i].position.y - grid.originY) / grid.Width(leafLevel)));
+        leafOf[i] = iy * leafSide + ix;
+        start[leafOf[i] + 1]++;
+    }
+    for (int c = 0; c < leaves; c++)
+        start[c + 1] += start[c];
+    {
+        std::vector<int> fill(start.begin(), start.end() - 1);
+        for (int i = 0; i < n; i++)
+            sorted[fill[leafOf[i]]++] = i;
+    }
+
+    std::vector<double> multipole((size_t)grid.cellCount * P, 0.0);
+    std::vector<double> local((size_t)grid.cellCount * P, 0.0);
+    std::vector<char> occupied(grid.cellCount, 0);
+
+    // P2M
+#pragma omp parallel
+    {
+        std::vector<double> pw(P);
+#pragma omp for schedule(dynamic, 16)
+        for (int c = 0; c < leaves; c++) {
+            if (start[c] == start[c + 1])
+                continue;
+            int ix = c % leafSide, iy = c / leafSide;
+            int cell = grid.Cell(leafLevel, ix, iy);
+            double* M = &multipole[(size_t)cell * P];
+            occupied[cell] = 1;
+            for (int k = start[c]; k < start[c + 1]; k++) {
+                const Body& b = bodies[sorted[k]];
+                ex.Powers(b.position.x - grid.CenterX(leafLevel, ix), b.position.y - grid.CenterY(leafLevel, iy), pw.data());
+                for (int t = 0; t < P; t++)
+                    M[t] += b.mass * pw[t];
+            }
+        }
+    }
+
+    // M2M, one level at a time from the leaves up
+    for (int l = leafLevel - 1; l >= 0; l--) {
+        const int side = grid.levels[l].side;
+#pragma omp parallel
+        {
+            std::vector<double> pw(P);
+#pragma omp for
+            for (int c = 0; c < side * side; c++) {
+                int ix = c % side, iy = c / side;
+                int cell = grid.Cell(l, ix, iy);
+                double* M = &multipole[(size_t)cell * P];
+                for (int q = 0; q < 4; q++) {
+                    int cx = 2 * ix + (q & 1), cy = 2 * iy + (q >> 1);
+                    int child = grid.Cell(l + 1, cx, cy);
+                    if (!occupied[child])
+                        continue;
+                    occupied[cell] = 1;
+                    const double* Mc = &multipole[(size_t)child * P];
+                    ex.Powers(grid.CenterX(l + 1, cx) - grid.CenterX(l, ix), grid.CenterY(l + 1, cy) - grid.CenterY(l, iy), pw.data());
+                    for (int na = 0; na <= order; na++) {
+                        for (int a = 0; a <= na; a++) {
+                            int b = na - a;
+                            double sum = 0;
+                            for (int ka = 0; ka <= a; ka++)
+                                for (int kb = 0; kb <= b; kb++)
+                                    sum += ex.Choose(a, ka) * ex.Choose(b, kb) * Mc[ex.At(ka, kb)] * pw[ex.At(a - ka, b - kb)];
+                            M[ex.At(a, b)] += sum;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // M2L over each cell's interaction list: children of the parent's neighbours
+    // that are not adjacent to the cell itself.
+    for (int l = 2; l <= leafLevel; l++) {
+        const int side = grid.levels[l].side;
+#pragma omp parallel
+        {
+            std::vector<double> T(P);
+#pragma omp for schedule(dynamic, 16)
+            for (int c = 0; c < side * side; c++) {
+                int ix = c % side, iy = c / side;
+                int cell = grid.Cell(l, ix, iy);
+                double* L = &local[(size_t)cell * P];
+                int px = ix / 2, py = iy / 2;
+
+                for (int sy = std::max(0, 2 * (py - 1)); sy <= std::min(side - 1, 2 * (py + 1) + 1); sy++) {
+                    for (int sx = std::max(0, 2 * (px - 1)); sx <= std::min(side - 1, 2 * (px + 1) + 1); sx++) {
+                        if (std::abs(sx - ix) <= 1 && std::abs(sy - iy) <= 1)
+                            continue;
+                        int source = grid.Cell(l, sx, sy);
+                        if (!occupied[source])
+                            continue;
+                        const double* M = &multipole[(size_t)source * P];
+                        ex.Derivatives(grid.CenterX(l, ix) - grid.CenterX(l, sx), grid.CenterY(l, iy) - grid.CenterY(l, sy), T.data());
+
+                        for (int nb = 0; nb <= order; nb++) {
+                            for (int ba = 0; ba <= nb; ba++) {
+                                int bb = nb - ba;
+                                double sum = 0;
+                                for (int na = 0; na <= order - nb; na++) {
+                                    double sign = (na & 1) ? -1 : 1;
+                                    for (int aa = 0; aa <= na; aa++) {
+                                        int ab = na - aa;
+                                        sum += sign * ex.Choose(aa + ba, aa) * ex.Choose(ab + bb, ab) * M[ex.At(aa, ab)] * T[ex.At(aa + ba, ab + bb)];
+                                    }
+                                }
+                                L[ex.At(ba, bb)] += sum;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // L2L from the root down
+    for (int l = 1; l <= leafLevel; l++) {
+        const int side = grid.levels[l].side;
+#pragma omp parallel
+        {
+            std::vector<double> pw(P);
+#pragma omp for
+            for (int c = 0; c < side * side; c++) {
+                int ix = c % side, iy = c / side;
+                int px = ix / 2, py = iy / 2;
+                double* L = &local[(size_t)grid.Cell(l, ix, iy) * P];
+                const double* Lp = &local[(size_t)grid.Cell(l - 1, px, py) * P];
+                ex.Powers(grid.CenterX(l, ix) - grid.CenterX(l - 1, px), grid.CenterY(l, iy) - grid.CenterY(l - 1, py), pw.data());
+
+                for (int nk = 0; nk <= order; nk++) {
+                    for (int ka = 0; ka <= nk; ka++) {
+                        int kb = nk - ka;
+                        double sum = 0;
+                        for (int nb = nk; nb <= order; nb++) {
+                            for (int ba = ka; ba <= nb - kb; ba++) {
+                                int bb = nb - ba;
+                                sum += Lp[ex.At(ba, bb)] * ex.Choose(ba, ka) * ex.Choose(bb, kb) * pw[ex.At(ba - ka, bb - kb)];
+                            }
+                        }
+                        L[ex.At(ka, kb)] += sum;
+                    }
+                }
+            }
+        }
+    }
+
+    // L2P for the far field plus direct sums over the 3x3 leaf neighbourhood.
+#pragma omp parallel
+    {
+        std::vector<double> pw(P);
+#pragma omp for schedule(dynamic, 16)
+        for (int c = 0; c < leaves; c++) {
+            int ix = c % leafSide, iy = c / leafSide;
+            const double* L = &local[(size_t)grid.Cell(leafLevel, ix, iy) * P];
+
+            for (int k = start[c]; k < start[c + 1]; k++) {
+                Body& b1 = bodies[sorted[k]];
+                double hx = b1.position.x - grid.CenterX(leafLevel, ix);
+                double hy = b1.position.y - grid.CenterY(leafLevel, iy);
+                ex.Powers(hx, hy, pw.data());
+
+                double ax = 0, ay = 0;
+                for (int nb = 1; nb <= order; nb++) {
+                    for (int a = 0; a <= nb; a++) {
+                        int b = nb - a;
+                        if (a >= 1)
+                            ax += a * L[ex.At(a, b)] * pw[ex.At(a - 1, b)];
+                        if (b >= 1)
+                            ay += b * L[ex.At(a, b)] * pw[ex.At(a, b - 1)];
+                    }
+                }
+                ax *= G;
+                ay *= G;
+
+                for (int ny = std::max(0, iy - 1); ny <= std::min(leafSide - 1, iy + 1); ny++) {
+                    for (int nx = std::max(0, ix - 1); nx <= std::min(leafSide - 1, ix + 1); nx++) {
+                        int nc = ny * leafSide + nx;
+                        for (int q = start[nc]; q < start[nc + 1]; q++) {
+                            const Body& b2 = bodies[sorted[q]];
+                            double dx = b2.position.x - b1.position.x;
+                            double dy = b2.position.y - b1.position.y;
+                            double r2 = dx * dx + dy * dy;
+                            if (r2 < 1e-12)
+                                continue;
+                            double s = G * b2.mass / ((r2 + SOFTENING) * std::sqrt(r2));
+                            ax += dx * s;
+                            ay += dy * s;
+                        }
+                    }
+                }
+
+                b1.velocity.x += ax;
+                b1.velocity.y += ay;
+            }
+        }
+    }
+}
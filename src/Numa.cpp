@@ -0,0 +1,175 @@
+#include <Numa.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <omp.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+struct NumaTopology {
+    std::vector<std::vector<int>> nodeCpus; // indexed by node id, may have empty gaps
+    std::vector<int> cpuNode;
+};
+
+// Parses a sysfs cpulist such as "0-3,8-11".
+static std::vector<int> ParseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    size_t start = 0;
+    while (start < list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        int first = 0, last = 0;
+        int fields = std::sscanf(list.substr(start, end - start).c_str(), "%d-%d", &first, &last);
+        if (fields == 1)
+            last = first;
+        for (int cpu = first; fields >= 1 && cpu <= last; cpu++)
+            cpus.push_back(cpu);
+        start = end + 1;
+    }
+    return cpus;
+}
+
+static NumaTopology DetectTopology()
+{
+    NumaTopology topology;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    bool masked = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        int node = 0;
+        if (std::sscanf(entry.path().filename().c_str(), "node%d", &node) != 1)
+            continue;
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        std::getline(file, list);
+
+        if ((int)topology.nodeCpus.size() <= node)
+            topology.nodeCpus.resize(node + 1);
+        for (int cpu : ParseCpuList(list)) {
+            if (masked && cpu < CPU_SETSIZE && !CPU_ISSET(cpu, &allowed))
+                continue;
+            topology.nodeCpus[node].push_back(cpu);
+        }
+    }
+
+    bool any = false;
+    for (const std::vector<int>& cpus : topology.nodeCpus)
+        any = any || !cpus.empty();
+    if (!any) {
+        topology.nodeCpus.assign(1, {});
+        int cores = std::max(1u, std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < cores; cpu++)
+            topology.nodeCpus[0].push_back(cpu);
+    }
+
+    for (size_t node = 0; node < topology.nodeCpus.size(); node++) {
+        std::sort(topology.nodeCpus[node].begin(), topology.nodeCpus[node].end());
+        for (int cpu : topology.nodeCpus[node]) {
+            if ((int)topology.cpuNode.size() <= cpu)
+                topology.cpuNode.resize(cpu + 1, 0);
+            topology.cpuNode[cpu] = node;
+        }
+    }
+    return topology;
+}
+
+static const NumaTopology& Topology()
+{
+    static const NumaTopology topology = DetectTopology();
+    return topology;
+}
+
+static Affinity activeAffinity = Affinity::None;
+
+int NumaNodeCount()
+{
+    return Topology().nodeCpus.size();
+}
+
+int NodeOfCpu(int cpu)
+{
+    const NumaTopology& t = Topology();
+    return cpu >= 0 && cpu < (int)t.cpuNode.size() ? t.cpuNode[cpu] : 0;
+}
+
+bool ParseAffinity(const std::string& name, Affinity& affinity)
+{
+    if (name == "none")
+        affinity = Affinity::None;
+    else if (name == "compact")
+        affinity = Affinity::Compact;
+    else if (name == "scatter")
+        affinity = Affinity::Scatter;
+    else
+        return false;
+    return true;
+}
+
+void SetAffinity(Affinity affinity)
+{
+    activeAffinity = affinity;
+}
+
+Affinity GetAffinity()
+{
+    return activeAffinity;
+}
+
+int CpuForThread(int thread, Affinity affinity)
+{
+    const NumaTopology& t = Topology();
+    std::vector<const std::vector<int>*> nodes;
+    int total = 0;
+    for (const std::vector<int>& cpus : t.nodeCpus) {
+        if (!cpus.empty())
+            nodes.push_back(&cpus);
+        total += cpus.size();
+    }
+    thread %= total;
+
+    if (affinity == Affinity::Scatter) {
+        // Deal one thread per node per round, skipping nodes that have run out.
+        for (int round = 0;; round++) {
+            for (const std::vector<int>* cpus : nodes) {
+                if (round >= (int)cpus->size())
+                    continue;
+                if (thread-- == 0)
+                    return (*cpus)[round];
+            }
+        }
+    }
+
+    for (const std::vector<int>* cpus : nodes) {
+        if (thread < (int)cpus->size())
+            return (*cpus)[thread];
+        thread -= cpus->size();
+    }
+    return 0;
+}
+
+bool PinThread(pthread_t thread, int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+}
+
+void PinOpenMPThreads()
+{
+    const Affinity affinity = activeAffinity;
+    if (affinity == Affinity::None)
+        return;
+#pragma omp parallel
+    {
+        const int t = omp_get_thread_num();
+        if (t != 0)
+            PinThread(pthread_self(), CpuForThread(t, affinity));
+    }
+}
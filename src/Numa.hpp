@@ -0,0 +1,32 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <pthread.h>
+#include <string>
+
+// NUMA topology read from /sys/devices/system/node, restricted to the CPUs this
+// process may run on. Machines without the sysfs tree look like one node.
+
+int NumaNodeCount(); // highest node id + 1
+int NodeOfCpu(int cpu);
+
+// How threads are spread over the machine: Compact fills node 0's cores
+// before moving on, Scatter deals threads round-robin across nodes.
+enum class Affinity {
+    None,
+    Compact,
+    Scatter,
+};
+bool ParseAffinity(const std::string& name, Affinity& affinity);
+void SetAffinity(Affinity affinity);
+Affinity GetAffinity();
+
+// CPU that thread number `thread` runs on under the given policy.
+int CpuForThread(int thread, Affinity affinity);
+bool PinThread(pthread_t thread, int cpu);
+// Pins the workers of the calling thread's OpenMP team of the current size per
+// GetAffinity(). The calling thread keeps its mask, since every thread or
+// process it creates later would inherit a single-CPU one.
+void PinOpenMPThreads();
+
+#endif // NUMA_HPP
@@ -0,0 +1,134 @@
+#include <BodySoA.hpp>
+#include <Numa.hpp>
+#include <Simulation.hpp>
+#include <algorithm>
+#include <omp.h>
+#include <sched.h>
+
+static const int NUMA_CHUNK = 16;
+
+void SimulateNuma(Simulation& sim, int steps, bool replicate)
+{
+    std::vector<Body>& bodies = sim.bodies;
+    const int n = bodies.size();
+    if (n == 0 || steps <= 0)
+        return;
+
+    sim.BeginStep();
+    const double G = sim.gravity;
+    const double deltaTime = sim.deltaTime;
+    const int width = sim.width;
+    const int height = sim.height;
+    double* ax = sim.ax.data();
+    double* ay = sim.ay.data();
+
+    const Affinity affinity = GetAffinity();
+    const int maxThreads = omp_get_max_threads();
+
+    // Read-mostly j-side positions, one copy per node (one shared copy when not
+    // replicating), each sized and refreshed by threads on that node.
+    std::vector<BodySoA>& replicas = sim.replicas;
+    replicas.resize(replicate ? NumaNodeCount() : 1);
+    int* threadGroup = sim.Arena(0).Allocate<int>(maxThreads);
+    double** ownedX = sim.Arena(0).Allocate<double*>(maxThreads);
+    double** ownedY = sim.Arena(0).Allocate<double*>(maxThreads);
+
+    // The caller runs as thread 0 and is pinned too, so its mask is put back
+    // afterwards; threads and processes it creates later inherit it.
+    cpu_set_t callerMask;
+    const bool restoreMask = affinity != Affinity::None && pthread_getaffinity_np(pthread_self(), sizeof(callerMask), &callerMask) == 0;
+
+#pragma omp parallel
+    {
+        const int t = omp_get_thread_num();
+        const int threads = omp_get_num_threads();
+        if (affinity != Affinity::None)
+            PinThread(pthread_self(), CpuForThread(t, affinity));
+        const int group = replicate ? NodeOfCpu(sched_getcpu()) : 0;
+        threadGroup[t] = group;
+        auto sliceBegin = [&](int s) { return (int)((long)n * s / threads); };
+
+        // Owned state: thread t owns a contiguous slice of bodies, kept in its
+        // own arena and first written by t, so the pages are local to it.
+        const int begin = sliceBegin(t);
+        const int end = sliceBegin(t + 1);
+        ScratchArena& arena = sim.Arena(t);
+        double* x = arena.Allocate<double>(end - begin);
+        double* y = arena.Allocate<double>(end - begin);
+        double* vx = arena.Allocate<double>(end - begin);
+        double* vy = arena.Allocate<double>(end - begin);
+        for (int i = begin; i < end; i++) {
+            x[i - begin] = bodies[i].position.x;
+            y[i - begin] = bodies[i].position.y;
+            vx[i - begin] = bodies[i].velocity.x;
+            vy[i - begin] = bodies[i].velocity.y;
+        }
+        ownedX[t] = x;
+        ownedY[t] = y;
+#pragma omp barrier
+
+        // Rank of this thread among the threads sharing its replica.
+        int rank = 0, groupSize = 0;
+        for (int s = 0; s < threads; s++) {
+            if (threadGroup[s] != group)
+                continue;
+            if (s < t)
+                rank++;
+            groupSize++;
+        }
+        BodySoA& local = replicas[group];
+        if (rank == 0) {
+            local.x.resize(n);
+            local.y.resize(n);
+            local.mass.resize(n);
+            for (int i = 0; i < n; i++)
+                local.mass[i] = bodies[i].mass;
+        }
+#pragma omp barrier
+
+        const int copyBegin = (int)((long)n * rank / groupSize);
+        const int copyEnd = (int)((long)n * (rank + 1) / groupSize);
+        for (int s = 0; s < steps; s++) {
+            for (int owner = 0; owner < threads; owner++) {
+                const int ob = sliceBegin(owner);
+                const int oe = std::min(sliceBegin(owner + 1), copyEnd);
+                for (int i = std::max(ob, copyBegin); i < oe; i++) {
+                    local.x[i] = ownedX[owner][i - ob];
+                    local.y[i] = ownedY[owner][i - ob];
+                }
+            }
+#pragma omp barrier
+
+            for (int cb = begin; cb < end; cb += NUMA_CHUNK) {
+                const int ce = cb + NUMA_CHUNK < end ? cb + NUMA_CHUNK : end;
+                for (int i = cb; i < ce; i++) {
+                    ax[i] = 0;
+                    ay[i] = 0;
+                }
+                AccumulateAccelerationsSIMD(local, cb, ce, G, ax, ay);
+
+                // Same order of operations as a force engine followed by UpdateMT.
+                for (int i = cb; i < ce; i++) {
+                    const int k = i - begin;
+                    vx[k] += ax[i];
+                    vy[k] += ay[i];
+                    if (x[k] < 0 || x[k] > width)
+                        vx[k] *= -1;
+                    if (y[k] < 0 || y[k] > height)
+                        vy[k] *= -1;
+                    x[k] += vx[k] * deltaTime;
+                    y[k] += vy[k] * deltaTime;
+                }
+            }
+#pragma omp barrier
+        }
+
+        for (int i = begin; i < end; i++) {
+            bodies[i].position = { x[i - begin], y[i - begin] };
+            bodies[i].velocity = { vx[i - begin], vy[i - begin] };
+        }
+    }
+
+    if (restoreMask)
+        pthread_setaffinity_np(pthread_self(), sizeof(callerMask), &callerMask);
+}
@@ -0,0 +1,234 @@
+#include <FFT.hpp>
+#include <Simulation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <omp.h>
+
+namespace {
+
+typedef std::complex<double> Complex;
+
+// Short-range split for P3M: the mesh carries K(r) * (1 - exp(-(r / rs)^2)) and
+// the remainder is summed directly out to CUTOFF_SPLITS * rs, where it is < 1e-4 of K.
+const double SPLIT_CELLS = 2.0;
+const double CUTOFF_SPLITS = 3.0;
+
+struct Mesh {
+    int size; // nodes per side that can receive mass
+    int padded; // FFT size, at least 2 * size for a non-periodic convolution
+    double originX, originY;
+    double h; // node spacing
+};
+
+Mesh MakeMesh(const std::vector<Body>& bodies, int gridSize)
+{
+    const int n = bodies.size();
+    double minx = bodies[0].position.x, maxx = minx;
+    double miny = bodies[0].position.y, maxy = miny;
+#pragma omp parallel for reduction(min : minx, miny) reduction(max : maxx, maxy)
+    for (int i = 0; i < n; i++) {
+        minx = std::min(minx, bodies[i].position.x);
+        maxx = std::max(maxx, bodies[i].position.x);
+        miny = std::min(miny, bodies[i].position.y);
+        maxy = std::max(maxy, bodies[i].position.y);
+    }
+
+    Mesh mesh;
+    mesh.size = std::max(gridSize, 4);
+    mesh.padded = NextPowerOfTwo(2 * mesh.size);
+    // Keep every body at least one node away from the far edge so CIC never
+    // writes outside the grid.
+    mesh.h = std::max(std::max(maxx - minx, maxy - miny), 1e-9) / (mesh.size - 2);
+    mesh.originX = minx;
+    mesh.originY = miny;
+    return mesh;
+}
+
+// Cloud-in-cell weights for one body: lower-left node and fractional offsets.
+inline void CICWeights(const Mesh& mesh, double px, double py, int& gx, int& gy, double& fx, double& fy)
+{
+    double ux = (px - mesh.originX) / mesh.h;
+    double uy = (py - mesh.originY) / mesh.h;
+    gx = std::min(std::max((int)ux, 0), mesh.size - 2);
+    gy = std::min(std::max((int)uy, 0), mesh.size - 2);
+    fx = ux - gx;
+    fy = uy - gy;
+}
+
+void DepositMass(const Mesh& mesh, const std::vector<Body>& bodies, std::vector<Complex>& rho)
+{
+    const int n = bodies.size();
+    const int cells = mesh.size * mesh.size;
+    const int P = mesh.padded;
+    const int threads = omp_get_max_threads();
+
+    // One private grid per thread, summed afterwards, instead of atomics per node.
+    std::vector<double> partial((size_t)threads * cells, 0.0);
+
+#pragma omp parallel
+    {
+        double* grid = &partial[(size_t)omp_get_thread_num() * cells];
+
+#pragma omp for
+        for (int i = 0; i < n; i++) {
+            int gx, gy;
+            double fx, fy;
+            CICWeights(mesh, bodies[i].position.x, bodies[i].position.y, gx, gy, fx, fy);
+            double m = bodies[i].mass;
+            grid[gy * mesh.size + gx] += m * (1 - fx) * (1 - fy);
+            grid[gy * mesh.size + gx + 1] += m * fx * (1 - fy);
+            grid[(gy + 1) * mesh.size + gx] += m * (1 - fx) * fy;
+            grid[(gy + 1) * mesh.size + gx + 1] += m * fx * fy;
+        }
+
+#pragma omp for
+        for (int c = 0; c < cells; c++) {
+            double sum = 0;
+            for (int t = 0; t < threads; t++)
+                sum += partial[(size_t)t * cells + c];
+            rho[(size_t)(c / mesh.size) * P + c % mesh.size] = sum;
+        }
+    }
+}
+
+// Acceleration kernel sampled on the padded grid, with negative offsets wrapped
+// around so that the circular convolution equals the open-boundary one.
+void BuildKernels(const Mesh& mesh, double G, double splitRadius, std::vector<Complex>& kx, std::vector<Complex>& ky)
+{
+    const int P = mesh.padded;
+
+#pragma omp parallel for
+    for (int row = 0; row < P; row++) {
+        int oy = row < P / 2 ? row : row - P;
+        for (int col = 0; col < P; col++) {
+            int ox = col < P / 2 ? col : col - P;
+            double dx = ox * mesh.h;
+            double dy = oy * mesh.h;
+            double r2 = dx * dx + dy * dy;
+            double s = 0;
+            if (r2 > 0) {
+                // Field at the node from a unit mass displaced by -offset.
+                s = G / ((r2 + SOFTENING) * std::sqrt(r2));
+                if (splitRadius > 0)
+                    s *= 1 - std::exp(-r2 / (splitRadius * splitRadius));
+            }
+            kx[(size_t)row * P + col] = -dx * s;
+            ky[(size_t)row * P + col] = -dy * s;
+        }
+    }
+
+    FFT2D(kx, P, P, false);
+    FFT2D(ky, P, P, false);
+}
+
+// Direct sum of the part of the force the mesh left out, over neighbouring cells.
+void ShortRangeCorrection(const std::vector<Body>& bodies, double G, double splitRadius, std::vector<Vec2>& acc)
+{
+    const int n = bodies.size();
+    const double cutoff = CUTOFF_SPLITS * splitRadius;
+    const double cutoff2 = cutoff * cutoff;
+
+    double minx = bodies[0].position.x, miny = bodies[0].position.y;
+    double maxx = minx, maxy = miny;
+    for (const Body& b : bodies) {
+        minx = std::min(minx, b.position.x);
+        miny = std::min(miny, b.position.y);
+        maxx = std::max(maxx, b.position.x);
+        maxy = std::max(maxy, b.position.y);
+    }
+    const int cx = std::max(1, (int)((maxx - minx) / cutoff) + 1);
+    const int cy = std::max(1, (int)((maxy - miny) / cutoff) + 1);
+
+    // Counting sort of bodies into cells of side `cutoff`.
+    std::vector<int> cellOf(n), start(cx * cy + 1, 0), sorted(n);
+    for (int i = 0; i < n; i++) {
+        int ix = std::min(cx - 1, (int)((bodies[i].position.x - minx) / cutoff));
+        int iy = std::min(cy - 1, (int)((bodies[i].position.y - miny) / cutoff));
+        cellOf[i] = iy * cx + ix;
+        start[cellOf[i] + 1]++;
+    }
+    for (int c = 0; c < cx * cy; c++)
+        start[c + 1] += start[c];
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    for (int i = 0; i < n; i++)
+        sorted[fill[cellOf[i]]++] = i;
+
+#pragma omp parallel for schedule(dynamic, 64)
+    for (int i = 0; i < n; i++) {
+        const Body& b1 = bodies[i];
+        int ix = cellOf[i] % cx;
+        int iy = cellOf[i] / cx;
+        Vec2 a = { 0, 0 };
+
+        for (int ny = std::max(0, iy - 1); ny <= std::min(cy - 1, iy + 1); ny++) {
+            for (int nx = std::max(0, ix - 1); nx <= std::min(cx - 1, ix + 1); nx++) {
+                int c = ny * cx + nx;
+                for (int k = start[c]; k < start[c + 1]; k++) {
+                    const Body& b2 = bodies[sorted[k]];
+                    double dx = b2.position.x - b1.position.x;
+                    double dy = b2.position.y - b1.position.y;
+                    double r2 = dx * dx + dy * dy;
+                    if (r2 < 1e-12 || r2 > cutoff2)
+                        continue;
+                    double s = G * b2.mass / ((r2 + SOFTENING) * std::sqrt(r2));
+                    s *= std::exp(-r2 / (splitRadius * splitRadius));
+                    a.x += dx * s;
+                    a.y += dy * s;
+                }
+            }
+        }
+        acc[i] = add(acc[i], a);
+    }
+}
+
+} // namespace
+
+void CalculateForcesPM(std::vector<Body>& bodies, double G, int gridSize, bool shortRange)
+{
+    const int n = bodies.size();
+    if (n == 0)
+        return;
+
+    const Mesh mesh = MakeMesh(bodies, gridSize);
+    const int P = mesh.padded;
+    const double splitRadius = shortRange ? SPLIT_CELLS * mesh.h : 0;
+
+    std::vector<Complex> rho((size_t)P * P, 0.0);
+    std::vector<Complex> kx((size_t)P * P), ky((size_t)P * P);
+
+    DepositMass(mesh, bodies, rho);
+    BuildKernels(mesh, G, splitRadius, kx, ky);
+    FFT2D(rho, P, P, false);
+
+#pragma omp parallel for
+    for (size_t k = 0; k < (size_t)P * P; k++) {
+        kx[k] *= rho[k];
+        ky[k] *= rho[k];
+    }
+
+    FFT2D(kx, P, P, true);
+    FFT2D(ky, P, P, true);
+
+    // Interpolate the field back with the same CIC weights used for the deposit.
+    std::vector<Vec2> acc(n);
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        int gx, gy;
+        double fx, fy;
+        CICWeights(mesh, bodies[i].position.x, bodies[i].position.y, gx, gy, fx, fy);
+        size_t k00 = (size_t)gy * P + gx;
+        size_t k01 = k00 + P;
+        double w00 = (1 - fx) * (1 - fy), w10 = fx * (1 - fy), w01 = (1 - fx) * fy, w11 = fx * fy;
+        acc[i].x = w00 * kx[k00].real() + w10 * kx[k00 + 1].real() + w01 * kx[k01].real() + w11 * kx[k01 + 1].real();
+        acc[i].y = w00 * ky[k00].real() + w10 * ky[k00 + 1].real() + w01 * ky[k01].real() + w11 * ky[k01 + 1].real();
+    }
+
+    if (shortRange)
+        ShortRangeCorrection(bodies, G, splitRadius, acc);
+
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        bodies[i].velocity = add(bodies[i].velocity, acc[i]);
+    }
+}
@@ -0,0 +1,61 @@
+#include <Pipeline.hpp>
+#include <Renderer.hpp>
+#include <SPSCQueue.hpp>
+#include <Trace.hpp>
+#include <thread>
+
+void RunRenderPipeline(std::vector<Body>& bodies, std::function<void(std::vector<Body>&)> step, int frames,
+    int width, int height, const char* filename, int delay, int depth)
+{
+    depth = depth < 1 ? 1 : depth;
+
+    std::vector<std::vector<Body>> states(depth, std::vector<Body>(bodies.size()));
+    FramePool pool(width, height, depth);
+
+    // Body snapshots travel as indices and stateFree returns them upstream once
+    // rendered; frame buffers come from and go back to the pool.
+    SPSCQueue<int> stateFree(depth), stateFull(depth);
+    SPSCQueue<FrameBuffer*> frameFull(depth);
+    for (int k = 0; k < depth; k++) {
+        stateFree.Push(k);
+    }
+
+    std::thread simulate([&] {
+        for (int f = 0; f < frames; f++) {
+            {
+                TRACE_SCOPE("step", "simulate");
+                step(bodies);
+            }
+            int s = stateFree.Pop();
+            states[s] = bodies;
+            stateFull.Push(s);
+        }
+    });
+
+    std::thread render([&] {
+        for (int f = 0; f < frames; f++) {
+            int s = stateFull.Pop();
+            std::unique_ptr<FrameBuffer> frame = pool.Acquire();
+            {
+                TRACE_SCOPE("render", "render");
+                RenderFrame(states[s], *frame);
+            }
+            stateFree.Push(s);
+            frameFull.Push(frame.release());
+        }
+    });
+
+    GifStream gif(filename, width, height, delay);
+    for (int f = 0; f < frames; f++) {
+        std::unique_ptr<FrameBuffer> frame(frameFull.Pop());
+        {
+            TRACE_SCOPE("encode", "encode");
+            gif.WriteFrame(frame->pixels);
+        }
+        pool.Release(std::move(frame));
+    }
+    gif.Close();
+
+    simulate.join();
+    render.join();
+}
@@ -0,0 +1,14 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "Body.hpp"
+#include <functional>
+#include <vector>
+
+// Runs simulate -> render -> GIF encode as three concurrent stages joined by
+// bounded queues. Only `depth` body snapshots and `depth` frame buffers are
+// ever allocated; they are recycled, so memory does not grow with `frames`.
+void RunRenderPipeline(std::vector<Body>& bodies, std::function<void(std::vector<Body>&)> step, int frames,
+    int width, int height, const char* filename, int delay = 4, int depth = 4);
+
+#endif // PIPELINE_HPP
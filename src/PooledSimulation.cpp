@@ -0,0 +1,60 @@
+#include <BodySoA.hpp>
+#include <Simulation.hpp>
+#include <ThreadPool.hpp>
+#include <functional>
+#include <utility>
+
+static const int POOL_GRAIN = 32;
+
+void SimulatePooled(Simulation& sim, int steps, ThreadPool& pool)
+{
+    sim.BeginStep();
+    std::vector<Body>& bodies = sim.bodies;
+    const double G = sim.gravity;
+    const double deltaTime = sim.deltaTime;
+    const int width = sim.width;
+    const int height = sim.height;
+    const int n = bodies.size();
+
+    // Positions are double-buffered: a step reads `cur` and writes `next`, so the
+    // force pass and the update can share one sweep and one barrier per step.
+    BodySoA& cur = sim.soa;
+    BodySoA& next = sim.nextSoa;
+    cur.Load(bodies);
+    next.Resize(n);
+    next.mass = cur.mass;
+    AlignedVector<double>& ax = sim.ax;
+    AlignedVector<double>& ay = sim.ay;
+
+    auto sweep = [&](int begin, int end) {
+        for (int i = begin; i < end; i++) {
+            ax[i] = 0;
+            ay[i] = 0;
+        }
+        AccumulateAccelerationsSIMD(cur, begin, end, G, ax.data(), ay.data());
+
+        // Same order of operations as a force engine followed by UpdateMT.
+        for (int i = begin; i < end; i++) {
+            double vx = cur.vx[i] + ax[i];
+            double vy = cur.vy[i] + ay[i];
+            if (cur.x[i] < 0 || cur.x[i] > width)
+                vx *= -1;
+            if (cur.y[i] < 0 || cur.y[i] > height)
+                vy *= -1;
+            next.vx[i] = vx;
+            next.vy[i] = vy;
+            next.x[i] = cur.x[i] + vx * deltaTime;
+            next.y[i] = cur.y[i] + vy * deltaTime;
+        }
+    };
+    // A single captured pointer fits std::function's inline storage, so the
+    // steps below do not allocate.
+    const std::function<void(int, int)> body = [&sweep](int begin, int end) { sweep(begin, end); };
+
+    for (int s = 0; s < steps; s++) {
+        pool.ParallelFor(n, POOL_GRAIN, body);
+        std::swap(cur, next);
+    }
+
+    cur.Store(bodies);
+}
@@ -0,0 +1,76 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <cmath>
+#include <cstdint>
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel Random
+// Numbers: As Easy as 1, 2, 3"). Output is a pure function of (seed, stream,
+// counter), so any thread can jump straight to its own stream without sharing
+// or advancing state elsewhere.
+class Philox {
+public:
+    Philox(uint64_t seed, uint64_t stream)
+        : key { (uint32_t)seed, (uint32_t)(seed >> 32) }
+        , stream(stream)
+    {
+    }
+
+    // Raw Philox4x32-10 of a 128-bit counter and 64-bit key.
+    static void Block(const uint32_t in[4], const uint32_t key[2], uint32_t out[4])
+    {
+        uint32_t c[4] = { in[0], in[1], in[2], in[3] };
+        uint32_t k[2] = { key[0], key[1] };
+        for (int round = 0; round < 10; round++) {
+            uint64_t p0 = (uint64_t)0xD2511F53u * c[0];
+            uint64_t p1 = (uint64_t)0xCD9E8D57u * c[2];
+            uint32_t next[4] = {
+                (uint32_t)(p1 >> 32) ^ c[1] ^ k[0],
+                (uint32_t)p1,
+                (uint32_t)(p0 >> 32) ^ c[3] ^ k[1],
+                (uint32_t)p0,
+            };
+            c[0] = next[0], c[1] = next[1], c[2] = next[2], c[3] = next[3];
+            k[0] += 0x9E3779B9u;
+            k[1] += 0xBB67AE85u;
+        }
+        out[0] = c[0], out[1] = c[1], out[2] = c[2], out[3] = c[3];
+    }
+
+    uint32_t NextU32()
+    {
+        if (used == 4) {
+            const uint32_t in[4] = { (uint32_t)counter, (uint32_t)(counter >> 32), (uint32_t)stream, (uint32_t)(stream >> 32) };
+            Block(in, key, buffer);
+            counter++;
+            used = 0;
+        }
+        return buffer[used++];
+    }
+
+    // Uniform in [0, 1) with 53 random bits.
+    double Uniform()
+    {
+        uint64_t hi = NextU32() >> 5, lo = NextU32() >> 6;
+        return (hi * 67108864.0 + lo) * (1.0 / 9007199254740992.0);
+    }
+
+    double Uniform(double min, double max) { return min + (max - min) * Uniform(); }
+
+    // Standard normal by Box-Muller; the second value is discarded to keep
+    // draws a fixed count per call.
+    double Normal()
+    {
+        double u = 1.0 - Uniform();
+        return std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * M_PI * Uniform());
+    }
+
+private:
+    uint32_t key[2];
+    uint64_t stream;
+    uint64_t counter = 0;
+    uint32_t buffer[4] = {};
+    int used = 4;
+};
+
+#endif // RANDOM_HPP
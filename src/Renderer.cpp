@@ -1,53 +1,265 @@
 #include "gif.h"
 #include <Renderer.hpp>
+#include <Trace.hpp>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <filesystem>
+#include <map>
+#include <thread>
 #include <vector>
 
-void WriteGif(const std::vector<std::vector<unsigned char>>& frames, int width, int height, const char* filename, int delay)
+// Palettizes and LZW-compresses one frame into a standalone GIF image block.
+// Pixels that match `last` are written as transparent, exactly as GifWriteFrame
+// does, except that `last` is the previous source frame rather than the previous
+// quantized output; this removes the serial dependency between frames.
+static std::vector<unsigned char> EncodeGifFrame(const unsigned char* last, const unsigned char* image, int width, int height, int delay)
+{
+    char* buffer = nullptr;
+    size_t size = 0;
+    FILE* f = open_memstream(&buffer, &size);
+
+    GifPalette pal;
+    GifMakePalette(last, image, width, height, 8, false, &pal);
+
+    std::vector<uint8_t> indexed((size_t)width * height * 4);
+    GifThresholdImage(last, image, indexed.data(), width, height, &pal);
+    GifWriteLzwImage(f, indexed.data(), 0, 0, width, height, delay, &pal);
+    fclose(f);
+
+    std::vector<unsigned char> out(buffer, buffer + size);
+    free(buffer);
+    return out;
+}
+
+// Each in-flight frame holds a full RGBA copy, so the encoder count is capped.
+static const int GIF_MAX_ENCODERS = 8;
+
+struct GifStream::Writer {
+    GifWriter gif;
+    bool open = false;
+
+    struct Job {
+        long index;
+        std::shared_ptr<const std::vector<unsigned char>> last, image;
+    };
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Job> jobs;
+    // Encoded frames waiting for the ones before them to be written.
+    std::map<long, std::vector<unsigned char>> done;
+    long submitted = 0;
+    long written = 0;
+    int limit = 1;
+    bool stopping = false;
+    std::shared_ptr<const std::vector<unsigned char>> previous;
+    std::vector<std::thread> encoders;
+};
+
+GifStream::GifStream(const char* filename, int width, int height, int delay)
+    : writer(new Writer)
+    , width(width)
+    , height(height)
+    , delay(delay)
 {
     if (std::filesystem::exists(filename)) {
         std::filesystem::remove(filename);
     }
+    writer->open = GifBegin(&writer->gif, filename, width, height, delay);
+    if (!writer->open)
+        return;
+
+    const int count = std::clamp((int)std::thread::hardware_concurrency(), 1, GIF_MAX_ENCODERS);
+    writer->limit = 2 * count;
+    for (int e = 0; e < count; e++) {
+        writer->encoders.emplace_back([this] {
+            Writer& w = *writer;
+            for (;;) {
+                Writer::Job job;
+                {
+                    std::unique_lock<std::mutex> lock(w.mutex);
+                    w.changed.wait(lock, [&] { return w.stopping || !w.jobs.empty(); });
+                    if (w.jobs.empty())
+                        return;
+                    job = std::move(w.jobs.front());
+                    w.jobs.pop_front();
+                }
 
-    GifWriter g;
-    GifBegin(&g, filename, width, height, delay);
+                std::vector<unsigned char> encoded;
+                {
+                    TRACE_SCOPE("encode frame", "encode");
+                    encoded = EncodeGifFrame(job.last ? job.last->data() : nullptr, job.image->data(), this->width, this->height, this->delay);
+                }
 
-    for (const auto& frame : frames) {
-        GifWriteFrame(&g, frame.data(), width, height, delay);
+                // Whoever completes the oldest outstanding frame appends it and
+                // every finished frame queued up behind it.
+                std::lock_guard<std::mutex> lock(w.mutex);
+                w.done.emplace(job.index, std::move(encoded));
+                while (!w.done.empty() && w.done.begin()->first == w.written) {
+                    const std::vector<unsigned char>& block = w.done.begin()->second;
+                    fwrite(block.data(), 1, block.size(), w.gif.f);
+                    w.done.erase(w.done.begin());
+                    w.written++;
+                }
+                w.changed.notify_all();
+            }
+        });
     }
+}
 
-    GifEnd(&g);
+GifStream::~GifStream()
+{
+    Close();
 }
 
-std::vector<unsigned char> RenderFrame(std::vector<Body>& bodies, int width, int height)
+void GifStream::WriteFrame(const std::vector<unsigned char>& frame)
+{
+    if (!writer->open)
+        return;
+
+    auto image = std::make_shared<const std::vector<unsigned char>>(frame);
+    std::unique_lock<std::mutex> lock(writer->mutex);
+    writer->changed.wait(lock, [&] { return writer->submitted - writer->written < writer->limit; });
+    writer->jobs.push_back({ writer->submitted++, writer->previous, image });
+    writer->previous = std::move(image);
+    writer->changed.notify_all();
+}
+
+void GifStream::Close()
+{
+    if (!writer->open)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(writer->mutex);
+        writer->changed.wait(lock, [&] { return writer->written == writer->submitted; });
+        writer->stopping = true;
+        writer->changed.notify_all();
+    }
+    for (std::thread& encoder : writer->encoders)
+        encoder.join();
+    writer->encoders.clear();
+    writer->previous.reset();
+
+    GifEnd(&writer->gif);
+    writer->open = false;
+}
+
+FrameBuffer::FrameBuffer(int width, int height)
+    : width(width)
+    , height(height)
+    , tilesX((width + RENDER_TILE - 1) / RENDER_TILE)
+    , tilesY((height + RENDER_TILE - 1) / RENDER_TILE)
+    , pixels((size_t)width * height * 4, 0)
+    , dirty(tilesX * tilesY, 0)
+{
+}
+
+FramePool::FramePool(int width, int height, int capacity)
+{
+    for (int k = 0; k < capacity; k++)
+        frames.push_back(std::make_unique<FrameBuffer>(width, height));
+}
+
+std::unique_ptr<FrameBuffer> FramePool::Acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    available.wait(lock, [this] { return !frames.empty(); });
+    std::unique_ptr<FrameBuffer> frame = std::move(frames.back());
+    frames.pop_back();
+    return frame;
+}
+
+void FramePool::Release(std::unique_ptr<FrameBuffer> frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        frames.push_back(std::move(frame));
+    }
+    available.notify_one();
+}
+
+void RenderFrame(const std::vector<Body>& bodies, FrameBuffer& frame)
 {
-    std::vector<unsigned char> frame(width * height * 4, 0);
-
-#pragma omp parallel for
-    for (int i = 0; i < bodies.size(); i++) {
-        const Body& b = bodies[i];
-        int cx = (int)((b.position.x));
-        int cy = (int)((b.position.y));
-
-        int radius = (int)(std::sqrt(b.mass));
-        radius = std::max(radius, 1);
-
-        for (int dy = -radius; dy <= radius; dy++) {
-            for (int dx = -radius; dx <= radius; dx++) {
-                int x = cx + dx;
-                int y = cy + dy;
-                if (x < 0 || x >= width || y < 0 || y >= height)
-                    continue;
-                if (dx * dx + dy * dy <= radius * radius) {
-                    int idx = (y * width + x) * 4;
-                    frame[idx + 0] = 255;
-                    frame[idx + 1] = 255;
-                    frame[idx + 2] = 255;
-                    frame[idx + 3] = 255;
+    const int width = frame.width;
+    const int height = frame.height;
+    const int tiles = frame.tilesX * frame.tilesY;
+
+    // Bin every on-screen body into each tile its disc overlaps (counting sort).
+    std::vector<int>& first = frame.binFirst;
+    std::vector<int>& binned = frame.binned;
+    first.assign(tiles + 1, 0);
+    auto forEachTile = [&](const Body& b, auto&& visit) {
+        int radius = std::max((int)std::sqrt(b.mass), 1);
+        if (!(b.position.x > -radius - 1 && b.position.x < width + radius + 1 && b.position.y > -radius - 1 && b.position.y < height + radius + 1))
+            return;
+        int cx = (int)b.position.x;
+        int cy = (int)b.position.y;
+        int tx0 = std::max(cx - radius, 0) / RENDER_TILE, tx1 = std::min(cx + radius, width - 1) / RENDER_TILE;
+        int ty0 = std::max(cy - radius, 0) / RENDER_TILE, ty1 = std::min(cy + radius, height - 1) / RENDER_TILE;
+        for (int ty = ty0; ty <= ty1; ty++)
+            for (int tx = tx0; tx <= tx1; tx++)
+                visit(ty * frame.tilesX + tx);
+    };
+    for (const Body& b : bodies)
+        forEachTile(b, [&](int t) { first[t + 1]++; });
+    for (int t = 0; t < tiles; t++)
+        first[t + 1] += first[t];
+    binned.resize(first[tiles]);
+    {
+        std::vector<int>& fill = frame.binFill;
+        fill.assign(first.begin(), first.end() - 1);
+        for (int i = 0; i < bodies.size(); i++)
+            forEachTile(bodies[i], [&](int t) { binned[fill[t]++] = i; });
+    }
+
+    // Each tile is cleared and drawn by exactly one thread, so there are no shared
+    // writes and the result does not depend on the thread count. Tiles that were
+    // empty last frame and are empty now are never touched.
+#pragma omp parallel for schedule(dynamic)
+    for (int t = 0; t < tiles; t++) {
+        bool occupied = first[t] != first[t + 1];
+        if (!occupied && !frame.dirty[t])
+            continue;
+
+        int x0 = (t % frame.tilesX) * RENDER_TILE, x1 = std::min(x0 + RENDER_TILE, width);
+        int y0 = (t / frame.tilesX) * RENDER_TILE, y1 = std::min(y0 + RENDER_TILE, height);
+
+        if (frame.dirty[t]) {
+            for (int y = y0; y < y1; y++)
+                std::memset(&frame.pixels[((size_t)y * width + x0) * 4], 0, (size_t)(x1 - x0) * 4);
+        }
+        frame.dirty[t] = occupied;
+
+        for (int k = first[t]; k < first[t + 1]; k++) {
+            const Body& b = bodies[binned[k]];
+            int cx = (int)b.position.x;
+            int cy = (int)b.position.y;
+            int radius = std::max((int)std::sqrt(b.mass), 1);
+
+            for (int y = std::max(cy - radius, y0); y < std::min(cy + radius + 1, y1); y++) {
+                int dy = y - cy;
+                for (int x = std::max(cx - radius, x0); x < std::min(cx + radius + 1, x1); x++) {
+                    int dx = x - cx;
+                    if (dx * dx + dy * dy <= radius * radius) {
+                        size_t idx = ((size_t)y * width + x) * 4;
+                        frame.pixels[idx + 0] = 255;
+                        frame.pixels[idx + 1] = 255;
+                        frame.pixels[idx + 2] = 255;
+                        frame.pixels[idx + 3] = 255;
+                    }
                 }
             }
         }
     }
-    return std::move(frame);
+}
+
+std::vector<unsigned char> RenderFrame(std::vector<Body>& bodies, int width, int height)
+{
+    FrameBuffer frame(width, height);
+    RenderFrame(bodies, frame);
+    return std::move(frame.pixels);
 }
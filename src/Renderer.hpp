@@ -4,9 +4,60 @@
 #define RENDERER_HPP
 
 #include "Body.hpp"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <vector>
-void WriteGif(const std::vector<std::vector<unsigned char>>& frames, int width, int height, const char* filename, int delay = 4);
+
+// Side length in pixels of the screen tiles the rasterizer bins bodies into.
+const int RENDER_TILE = 64;
+
+// RGBA frame plus a per-tile flag recording which tiles hold drawn pixels, so
+// the next render into the same buffer only has to clear those tiles.
+struct FrameBuffer {
+    int width, height;
+    int tilesX, tilesY;
+    std::vector<unsigned char> pixels;
+    std::vector<char> dirty;
+    // Tile binning scratch, kept with the buffer so rendering does not allocate.
+    std::vector<int> binFirst, binned, binFill;
+
+    FrameBuffer(int width, int height);
+};
+
+// Fixed set of reusable frame buffers; Acquire blocks until one is free.
+class FramePool {
+public:
+    FramePool(int width, int height, int capacity);
+
+    std::unique_ptr<FrameBuffer> Acquire();
+    void Release(std::unique_ptr<FrameBuffer> frame);
+
+private:
+    std::mutex mutex;
+    std::condition_variable available;
+    std::vector<std::unique_ptr<FrameBuffer>> frames;
+};
 
 std::vector<unsigned char> RenderFrame(std::vector<Body>& bodies, int width, int height);
+// Tile-binned rasterizer drawing into a caller-owned, reusable buffer.
+void RenderFrame(const std::vector<Body>& bodies, FrameBuffer& frame);
+
+// Appends frames to a GIF one at a time instead of needing them all up front.
+// Frames are palettized and compressed on a few encoder threads and written in
+// order as they finish; WriteFrame only blocks once enough frames are in flight.
+class GifStream {
+public:
+    GifStream(const char* filename, int width, int height, int delay = 4);
+    ~GifStream();
+
+    void WriteFrame(const std::vector<unsigned char>& frame);
+    void Close();
+
+private:
+    struct Writer;
+    std::unique_ptr<Writer> writer;
+    int width, height, delay;
+};
 
 #endif // RENDERER_HPP
@@ -0,0 +1,59 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+template <typename T>
+class SPSCQueue {
+public:
+    explicit SPSCQueue(std::size_t capacity)
+        : slots(capacity + 1)
+    {
+    }
+
+    bool TryPush(const T& value)
+    {
+        std::size_t tail = this->tail.load(std::memory_order_relaxed);
+        std::size_t next = (tail + 1) % slots.size();
+        if (next == head.load(std::memory_order_acquire))
+            return false;
+        slots[tail] = value;
+        this->tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T& value)
+    {
+        std::size_t head = this->head.load(std::memory_order_relaxed);
+        if (head == tail.load(std::memory_order_acquire))
+            return false;
+        value = slots[head];
+        this->head.store((head + 1) % slots.size(), std::memory_order_release);
+        return true;
+    }
+
+    void Push(const T& value)
+    {
+        while (!TryPush(value))
+            std::this_thread::yield();
+    }
+
+    T Pop()
+    {
+        T value;
+        while (!TryPop(value))
+            std::this_thread::yield();
+        return value;
+    }
+
+private:
+    std::vector<T> slots;
+    alignas(64) std::atomic<std::size_t> head { 0 };
+    alignas(64) std::atomic<std::size_t> tail { 0 };
+};
+
+#endif // SPSC_QUEUE_HPP
@@ -0,0 +1,229 @@
+#include <BodySoA.hpp>
+#include <ForceLaw.hpp>
+#include <Simulation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <immintrin.h>
+#include <omp.h>
+#include <type_traits>
+
+// Matches the cutoff in Direction(): pairs closer than this contribute nothing.
+static const double MIN_DIST_SQRD = 0.000001 * 0.000001;
+
+typedef void (*AccelKernel)(const BodySoA&, int, int, double, double*, double*);
+
+template <typename Law>
+static inline void AccumulateRows(const BodySoA& soa, int begin, int end, double G, double* ax, double* ay, const Law& law)
+{
+    const int n = soa.size();
+    const double* x = soa.x.data();
+    const double* y = soa.y.data();
+    const double* m = soa.mass.data();
+
+    for (int i = begin; i < end; i++) {
+        const double xi = x[i];
+        const double yi = y[i];
+        double axi = 0;
+        double ayi = 0;
+
+#pragma omp simd reduction(+ : axi, ayi)
+        for (int j = 0; j < n; j++) {
+            double dx = x[j] - xi;
+            double dy = y[j] - yi;
+            double s = law(dx * dx + dy * dy, G * m[j]);
+            axi += dx * s;
+            ayi += dy * s;
+        }
+
+        ax[i] += axi;
+        ay[i] += ayi;
+    }
+}
+
+static void AccumulateScalar(const BodySoA& soa, int begin, int end, double G, double* ax, double* ay)
+{
+    AccumulateRows(soa, begin, end, G, ax, ay, SoftenedGravity());
+}
+
+// Any other law: the same loop, vectorized by the compiler for each clone.
+template <typename Law>
+__attribute__((target_clones("avx512f", "avx2", "default"))) static void AccumulateLaw(const BodySoA& soa, int begin, int end, double G,
+    double* ax, double* ay, Law law)
+{
+    AccumulateRows(soa, begin, end, G, ax, ay, law);
+}
+
+__attribute__((target("avx2,fma"))) static void AccumulateAVX2(const BodySoA& soa, int begin, int end, double G, double* ax, double* ay)
+{
+    const int n = soa.size();
+    const int nVec = n & ~3;
+    const double* x = soa.x.data();
+    const double* y = soa.y.data();
+    const double* m = soa.mass.data();
+
+    const __m256d vG = _mm256_set1_pd(G);
+    const __m256d vEps = _mm256_set1_pd(SOFTENING);
+    const __m256d vMin = _mm256_set1_pd(MIN_DIST_SQRD);
+    const __m256d vOne = _mm256_set1_pd(1.0);
+
+    for (int i = begin; i < end; i++) {
+        const __m256d xi = _mm256_set1_pd(x[i]);
+        const __m256d yi = _mm256_set1_pd(y[i]);
+        __m256d axi = _mm256_setzero_pd();
+        __m256d ayi = _mm256_setzero_pd();
+
+        for (int j = 0; j < nVec; j += 4) {
+            __m256d dx = _mm256_sub_pd(_mm256_load_pd(x + j), xi);
+            __m256d dy = _mm256_sub_pd(_mm256_load_pd(y + j), yi);
+            __m256d r2 = _mm256_fmadd_pd(dy, dy, _mm256_mul_pd(dx, dx));
+
+            // One sqrt and one divide per pair: s = G * m / ((r^2 + eps) * r)
+            __m256d inv = _mm256_div_pd(vOne, _mm256_mul_pd(_mm256_add_pd(r2, vEps), _mm256_sqrt_pd(r2)));
+            __m256d s = _mm256_mul_pd(_mm256_mul_pd(vG, _mm256_load_pd(m + j)), inv);
+            s = _mm256_and_pd(s, _mm256_cmp_pd(r2, vMin, _CMP_GE_OQ));
+
+            axi = _mm256_fmadd_pd(dx, s, axi);
+            ayi = _mm256_fmadd_pd(dy, s, ayi);
+        }
+
+        alignas(32) double sx[4], sy[4];
+        _mm256_store_pd(sx, axi);
+        _mm256_store_pd(sy, ayi);
+        double axs = sx[0] + sx[1] + sx[2] + sx[3];
+        double ays = sy[0] + sy[1] + sy[2] + sy[3];
+
+        for (int j = nVec; j < n; j++) {
+            double dx = x[j] - x[i];
+            double dy = y[j] - y[i];
+            double r2 = dx * dx + dy * dy;
+            if (r2 < MIN_DIST_SQRD)
+                continue;
+            double s = G * m[j] / ((r2 + SOFTENING) * std::sqrt(r2));
+            axs += dx * s;
+            ays += dy * s;
+        }
+
+        ax[i] += axs;
+        ay[i] += ays;
+    }
+}
+
+__attribute__((target("avx512f"))) static void AccumulateAVX512(const BodySoA& soa, int begin, int end, double G, double* ax, double* ay)
+{
+    const int n = soa.size();
+    const int nVec = n & ~7;
+    const double* x = soa.x.data();
+    const double* y = soa.y.data();
+    const double* m = soa.mass.data();
+
+    const __m512d vG = _mm512_set1_pd(G);
+    const __m512d vEps = _mm512_set1_pd(SOFTENING);
+    const __m512d vMin = _mm512_set1_pd(MIN_DIST_SQRD);
+    const __m512d vOne = _mm512_set1_pd(1.0);
+
+    for (int i = begin; i < end; i++) {
+        const __m512d xi = _mm512_set1_pd(x[i]);
+        const __m512d yi = _mm512_set1_pd(y[i]);
+        __m512d axi = _mm512_setzero_pd();
+        __m512d ayi = _mm512_setzero_pd();
+
+        for (int j = 0; j < nVec; j += 8) {
+            __m512d dx = _mm512_sub_pd(_mm512_load_pd(x + j), xi);
+            __m512d dy = _mm512_sub_pd(_mm512_load_pd(y + j), yi);
+            __m512d r2 = _mm512_fmadd_pd(dy, dy, _mm512_mul_pd(dx, dx));
+
+            __m512d inv = _mm512_div_pd(vOne, _mm512_mul_pd(_mm512_add_pd(r2, vEps), _mm512_sqrt_pd(r2)));
+            __m512d s = _mm512_mul_pd(_mm512_mul_pd(vG, _mm512_load_pd(m + j)), inv);
+            __mmask8 near = _mm512_cmp_pd_mask(r2, vMin, _CMP_GE_OQ);
+
+            axi = _mm512_mask3_fmadd_pd(dx, s, axi, near);
+            ayi = _mm512_mask3_fmadd_pd(dy, s, ayi, near);
+        }
+
+        double axs = _mm512_reduce_add_pd(axi);
+        double ays = _mm512_reduce_add_pd(ayi);
+
+        for (int j = nVec; j < n; j++) {
+            double dx = x[j] - x[i];
+            double dy = y[j] - y[i];
+            double r2 = dx * dx + dy * dy;
+            if (r2 < MIN_DIST_SQRD)
+                continue;
+            double s = G * m[j] / ((r2 + SOFTENING) * std::sqrt(r2));
+            axs += dx * s;
+            ays += dy * s;
+        }
+
+        ax[i] += axs;
+        ay[i] += ays;
+    }
+}
+
+static AccelKernel SelectKernel()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return AccumulateAVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return AccumulateAVX2;
+    return AccumulateScalar;
+}
+
+static AccelKernel ActiveKernel()
+{
+    static const AccelKernel kernel = SelectKernel();
+    return kernel;
+}
+
+const char* SIMDKernelName()
+{
+    AccelKernel k = ActiveKernel();
+    if (k == AccumulateAVX512)
+        return "avx512";
+    if (k == AccumulateAVX2)
+        return "avx2";
+    return "scalar";
+}
+
+void AccumulateAccelerationsSIMD(const BodySoA& soa, int begin, int end, double G, double* ax, double* ay)
+{
+    ActiveKernel()(soa, begin, end, G, ax, ay);
+}
+
+template <typename Law>
+void CalculateForcesSIMD(Simulation& sim, const Law& law)
+{
+    sim.BeginStep();
+    std::vector<Body>& bodies = sim.bodies;
+    const double G = sim.gravity;
+    const int n = bodies.size();
+    BodySoA& soa = sim.soa;
+    soa.Load(bodies);
+    AlignedVector<double>& ax = sim.ax;
+    AlignedVector<double>& ay = sim.ay;
+    std::fill(ax.begin(), ax.end(), 0.0);
+    std::fill(ay.begin(), ay.end(), 0.0);
+
+    const AccelKernel kernel = ActiveKernel();
+    const int chunk = 16;
+
+#pragma omp parallel for schedule(dynamic)
+    for (int begin = 0; begin < n; begin += chunk) {
+        int end = begin + chunk < n ? begin + chunk : n;
+        // The hand-written kernels are SoftenedGravity spelled out in intrinsics.
+        if constexpr (std::is_same<Law, SoftenedGravity>::value)
+            kernel(soa, begin, end, G, ax.data(), ay.data());
+        else
+            AccumulateLaw(soa, begin, end, G, ax.data(), ay.data(), law);
+    }
+
+#pragma omp parallel for
+    for (int i = 0; i < n; i++) {
+        bodies[i].velocity.x += ax[i];
+        bodies[i].velocity.y += ay[i];
+    }
+}
+
+template void CalculateForcesSIMD(Simulation&, const SoftenedGravity&);
+template void CalculateForcesSIMD(Simulation&, const Plummer&);
+template void CalculateForcesSIMD(Simulation&, const Cutoff<SoftenedGravity>&);
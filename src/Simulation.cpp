@@ -1,10 +1,14 @@
 #include "Body.hpp"
 #include <Simulation.hpp>
+#include <Trace.hpp>
 #include <Vec.hpp>
+#include <algorithm>
 #include <omp.h>
 
-void CalculateForcesSequential(std::vector<Body>& bodies, double G)
+void CalculateForcesSequential(Simulation& sim)
 {
+    std::vector<Body>& bodies = sim.bodies;
+    const double G = sim.gravity;
     for (int i = 0; i < bodies.size(); i++) {
         for (int j = 0; j < bodies.size(); j++) {
             if (i == j)
@@ -38,29 +42,37 @@ void UpdateSequential(std::vector<Body>& bodies, double deltaTime, int width, in
     }
 }
 
-void CalculateForcesMTReduction(std::vector<Body>& bodies, double G)
+void CalculateForcesMTReduction(Simulation& sim)
 {
-
+    sim.BeginStep();
+    std::vector<Body>& bodies = sim.bodies;
+    const double G = sim.gravity;
     const int n = bodies.size();
-    std::vector<Vec2> accelerations(n, { 0, 0 });
+    std::vector<Vec2>& accelerations = sim.accelerations;
+    std::fill(accelerations.begin(), accelerations.end(), Vec2 { 0, 0 });
 
 #pragma omp parallel
     {
-        std::vector<Vec2> local_accel(n, { 0, 0 });
+        Vec2* local_accel = sim.Arena(omp_get_thread_num()).Allocate<Vec2>(n);
+        std::fill(local_accel, local_accel + n, Vec2 { 0, 0 });
 
-#pragma omp for schedule(dynamic)
-        for (int i = 0; i < n; i++) {
-            for (int j = 0; j < n; j++) {
-                const Body& b1 = bodies[i];
-                const Body& b2 = bodies[j];
-                double force = Force(b1, b2, G);
-                Vec2 dir = Direction(b1.position, b2.position);
+        {
+            // Per-thread span; nowait keeps barrier time out of it so imbalance shows.
+            TRACE_SCOPE("force rows", "force");
+#pragma omp for schedule(dynamic) nowait
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    const Body& b1 = bodies[i];
+                    const Body& b2 = bodies[j];
+                    double force = Force(b1, b2, G);
+                    Vec2 dir = Direction(b1.position, b2.position);
 
-                double acc1 = force / b1.mass;
+                    double acc1 = force / b1.mass;
 
-                Vec2 acc_vec1 = scale(dir, acc1);
+                    Vec2 acc_vec1 = scale(dir, acc1);
 
-                local_accel[i] = add(local_accel[i], acc_vec1);
+                    local_accel[i] = add(local_accel[i], acc_vec1);
+                }
             }
         }
 
@@ -78,29 +90,37 @@ void CalculateForcesMTReduction(std::vector<Body>& bodies, double G)
     }
 }
 
-void CalculateForcesMTReductionStatic(std::vector<Body>& bodies, double G)
+void CalculateForcesMTReductionStatic(Simulation& sim)
 {
-
+    sim.BeginStep();
+    std::vector<Body>& bodies = sim.bodies;
+    const double G = sim.gravity;
     const int n = bodies.size();
-    std::vector<Vec2> accelerations(n, { 0, 0 });
+    std::vector<Vec2>& accelerations = sim.accelerations;
+    std::fill(accelerations.begin(), accelerations.end(), Vec2 { 0, 0 });
 
 #pragma omp parallel
     {
-        std::vector<Vec2> local_accel(n, { 0, 0 });
+        Vec2* local_accel = sim.Arena(omp_get_thread_num()).Allocate<Vec2>(n);
+        std::fill(local_accel, local_accel + n, Vec2 { 0, 0 });
 
-#pragma omp for schedule(static)
-        for (int i = 0; i < n; i++) {
-            for (int j = 0; j < n; j++) {
-                const Body& b1 = bodies[i];
-                const Body& b2 = bodies[j];
-                double force = Force(b1, b2, G);
-                Vec2 dir = Direction(b1.position, b2.position);
+        {
+            // Per-thread span; nowait keeps barrier time out of it so imbalance shows.
+            TRACE_SCOPE("force rows", "force");
+#pragma omp for schedule(static) nowait
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    const Body& b1 = bodies[i];
+                    const Body& b2 = bodies[j];
+                    double force = Force(b1, b2, G);
+                    Vec2 dir = Direction(b1.position, b2.position);
 
-                double acc1 = force / b1.mass;
+                    double acc1 = force / b1.mass;
 
-                Vec2 acc_vec1 = scale(dir, acc1);
+                    Vec2 acc_vec1 = scale(dir, acc1);
 
-                local_accel[i] = add(local_accel[i], acc_vec1);
+                    local_accel[i] = add(local_accel[i], acc_vec1);
+                }
             }
         }
 
@@ -118,9 +138,13 @@ void CalculateForcesMTReductionStatic(std::vector<Body>& bodies, double G)
     }
 }
 
-void CalculateForcesMTAtomic(std::vector<Body>& bodies, double G)
+void CalculateForcesMTAtomic(Simulation& sim)
 {
-    std::vector<Vec2> accelerations(bodies.size(), { 0, 0 });
+    sim.BeginStep();
+    std::vector<Body>& bodies = sim.bodies;
+    const double G = sim.gravity;
+    std::vector<Vec2>& accelerations = sim.accelerations;
+    std::fill(accelerations.begin(), accelerations.end(), Vec2 { 0, 0 });
 
 #pragma omp parallel for schedule(dynamic)
     for (int i = 0; i < bodies.size(); i++) {
@@ -150,9 +174,13 @@ void CalculateForcesMTAtomic(std::vector<Body>& bodies, double G)
     }
 }
 
-void CalculateForcesMTAtomicStatic(std::vector<Body>& bodies, double G)
+void CalculateForcesMTAtomicStatic(Simulation& sim)
 {
-    std::vector<Vec2> accelerations(bodies.size(), { 0, 0 });
+    sim.BeginStep();
+    std::vector<Body>& bodies = sim.bodies;
+    const double G = sim.gravity;
+    std::vector<Vec2>& accelerations = sim.accelerations;
+    std::fill(accelerations.begin(), accelerations.end(), Vec2 { 0, 0 });
 
 #pragma omp parallel for schedule(static)
     for (int i = 0; i < bodies.size(); i++) {
@@ -182,10 +210,13 @@ void CalculateForcesMTAtomicStatic(std::vector<Body>& bodies, double G)
     }
 }
 
-void CalculateForcesMTCritical(std::vector<Body>& bodies, double G)
+void CalculateForcesMTCritical(Simulation& sim)
 {
-
-    std::vector<Vec2> accelerations(bodies.size(), { 0, 0 });
+    sim.BeginStep();
+    std::vector<Body>& bodies = sim.bodies;
+    const double G = sim.gravity;
+    std::vector<Vec2>& accelerations = sim.accelerations;
+    std::fill(accelerations.begin(), accelerations.end(), Vec2 { 0, 0 });
 
 #pragma omp parallel for
     for (int i = 0; i < bodies.size(); i++) {
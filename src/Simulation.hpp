@@ -2,16 +2,173 @@
 #define SIMULATION_HPP
 
 #include "Body.hpp"
+#include "BodySoA.hpp"
+#include "ForceLaw.hpp"
+#include "SimulationContext.hpp"
+#include "Transport.hpp"
+#include <string>
 #include <vector>
 
-void CalculateForcesSequential(std::vector<Body>& bodies, double G);
+class ThreadPool;
+
+// The classic engines run on a Simulation context and take their scratch from
+// it instead of allocating every call.
+void CalculateForcesSequential(Simulation& sim);
 void UpdateSequential(std::vector<Body>& bodies, double deltaTime, int width, int height);
 
-void CalculateForcesMTReduction(std::vector<Body>& bodies, double G);
-void CalculateForcesMTReductionStatic(std::vector<Body>& bodies, double G);
-void CalculateForcesMTAtomic(std::vector<Body>& bodies, double G);
-void CalculateForcesMTAtomicStatic(std::vector<Body>& bodies, double G);
-void CalculateForcesMTCritical(std::vector<Body>& bodies, double G);
+void CalculateForcesMTReduction(Simulation& sim);
+void CalculateForcesMTReductionStatic(Simulation& sim);
+void CalculateForcesMTAtomic(Simulation& sim);
+void CalculateForcesMTAtomicStatic(Simulation& sim);
+void CalculateForcesMTCritical(Simulation& sim);
 void UpdateMT(std::vector<Body>& bodies, double deltaTime, int width, int height);
 
+// Vectorized all-pairs kernel over a SoA copy of the bodies. The widest
+// instruction set the CPU supports (AVX-512, AVX2+FMA, scalar) is picked at
+// runtime. Instantiated for SoftenedGravity, Plummer and Cutoff<SoftenedGravity>.
+template <typename Law = SoftenedGravity>
+void CalculateForcesSIMD(Simulation& sim, const Law& law = Law());
+// Adds the acceleration on bodies [begin, end) from every body in soa into ax/ay.
+void AccumulateAccelerationsSIMD(const BodySoA& soa, int begin, int end, double G, double* ax, double* ay);
+const char* SIMDKernelName();
+
+// Mixed-precision all-pairs kernel: the pair loop runs in float on positions
+// relative to a per-tile origin, with rsqrt plus one Newton step, and the tile
+// sums are accumulated in double. About twice the lanes of the double kernel.
+void CalculateForcesMixed(Simulation& sim);
+
+// Bit-identical for any thread count: each row's sum over j is split into
+// fixed chunks combined by a fixed-shape pairwise tree. With compensated set,
+// chunks use Neumaier summation and the tree carries the error terms.
+void CalculateForcesDeterministic(Simulation& sim, bool compensated = false);
+
+// Evaluates every unordered pair once and applies equal and opposite accelerations.
+// Blocks of bodies are paired by a round-robin schedule so no two threads ever
+// write the same block at the same time.
+void CalculateForcesSymmetric(Simulation& sim);
+
+// Cache-blocked all-pairs kernel: a block of iBlock bodies is swept against
+// j-tiles of jTile bodies so each tile is reused from L1 across the whole block.
+struct TileConfig {
+    int iBlock;
+    int jTile;
+};
+// Sizes derived from the L1/L2 cache sizes, or from NBODY_TILE=<iBlock>x<jTile>.
+TileConfig DetectTileConfig();
+TileConfig GetTileConfig();
+void SetTileConfig(TileConfig config);
+// Instantiated for the same laws as CalculateForcesSIMD.
+template <typename Law = SoftenedGravity>
+void CalculateForcesTiled(Simulation& sim, const Law& law = Law());
+
+// Runs `steps` full timesteps on a persistent work-stealing pool: one fused
+// force+update sweep and one lightweight barrier per step instead of several
+// OpenMP fork/join regions.
+void SimulatePooled(Simulation& sim, int steps, ThreadPool& pool);
+
+// NUMA-aware all-pairs stepping: each OpenMP thread owns a static slice of the
+// bodies and first-touches its state, threads are pinned per GetAffinity(),
+// and with replicate set the j-side positions are copied to every node each
+// step so the pair loop only reads local memory.
+void SimulateNuma(Simulation& sim, int steps, bool replicate = true);
+
+// Distributed-memory all-pairs over `ranks` local processes, forked from the
+// caller, which acts as rank 0. Each rank owns a contiguous slice of the bodies
+// and the slices circulate around a ring, a rank computing against the block
+// in hand while forwarding it to the next. Same arithmetic as
+// CalculateForcesSequential followed by UpdateSequential, summed in ring order.
+const int DISTRIBUTED_RANKS = 4;
+bool SimulateDistributed(std::vector<Body>& bodies, double G, double deltaTime, int width, int height, int steps,
+    int ranks = DISTRIBUTED_RANKS, TransportKind transport = TransportKind::SharedMemory);
+
+// Many independent small systems in one batch. Storage is body-major with
+// systems interleaved: body i of system s lives at [i * stride + s], stride
+// being the system count rounded up to ENSEMBLE_LANES.
+const int ENSEMBLE_LANES = 8;
+struct EnsembleBatch {
+    int systems = 0;
+    int bodies = 0; // bodies in the largest system; shorter ones are padded
+    int stride = 0;
+    std::vector<int> counts;
+    AlignedVector<double> x, y, vx, vy, mass;
+
+    void Load(const std::vector<std::vector<Body>>& systems);
+    void Store(std::vector<std::vector<Body>>& systems) const;
+};
+// Steps every system as a force engine followed by UpdateMT would. Threads
+// split the batch by groups of ENSEMBLE_LANES systems, which share SIMD lanes.
+void SimulateEnsemble(EnsembleBatch& batch, double G, double deltaTime, int width, int height, int steps);
+void SimulateEnsemble(std::vector<std::vector<Body>>& systems, double G, double deltaTime, int width, int height, int steps);
+
+// Symplectic integrators for SimulateFused. Unlike the force engines above,
+// which add the acceleration straight onto the velocity, these integrate with
+// the physical timestep (v += a * dt).
+enum class Integrator {
+    Leapfrog, // drift-kick-drift, 1 force evaluation per step
+    VelocityVerlet, // kick-drift-kick, 1 per step plus 1
+    Yoshida4, // 4th order, 3 per step
+};
+bool ParseIntegrator(const std::string& name, Integrator& integrator);
+
+// Computes forces and integrates in a single parallel sweep per force
+// evaluation, with edge reflection folded into the same pass.
+// Lets velocity Verlet carry the accelerations of its closing half-kick into
+// the next call, so stepping one frame at a time costs one force evaluation
+// per step like a single long call. Ignored when the bodies moved in between.
+// It also holds the sweep buffers, so stepping that way allocates nothing.
+struct FusedState {
+    AlignedVector<double> x, y; // positions the accelerations were taken at
+    AlignedVector<double> ax, ay;
+    BodySoA cur, next;
+
+    bool Matches(const BodySoA& soa) const;
+};
+void SimulateFused(std::vector<Body>& bodies, double G, double deltaTime, int width, int height, int steps, Integrator integrator,
+    FusedState* state = nullptr);
+
+// Hierarchical block timesteps: each body steps with deltaTime / 2^level, the
+// level picked from eta * |a| / |da/dt|, and only the bodies whose block ends at
+// the current tick are force-evaluated. Integrates with the physical timestep,
+// kick-drift-kick per body; `steps` counts base steps of deltaTime.
+struct BlockTimestepConfig {
+    int maxLevel = 8;
+    double eta = 0.02;
+};
+struct BlockTimestepStats {
+    long long forceEvaluations = 0; // pair interactions evaluated
+    long long substeps = 0;
+};
+// Buffers of SimulateBlockTimesteps; a caller stepping one frame at a time
+// passes the same state every call so nothing is allocated per call. Every
+// block ends on a base step, so a call ends with all bodies synchronized; the
+// state keeps their accelerations, jerks and levels from that final tick, and
+// the next call starts from them instead of a fresh evaluation, stepping like
+// one long call. Ignored when the bodies changed in between.
+struct BlockTimestepState {
+    BodySoA soa;
+    AlignedVector<double> ax, ay, jx, jy;
+    std::vector<int> level;
+    std::vector<long long> lastTick;
+    std::vector<int> active;
+    int maxLevel = -1; // level grid of the carried values, -1 before any call
+
+    bool Matches(const std::vector<Body>& bodies) const;
+};
+BlockTimestepStats SimulateBlockTimesteps(std::vector<Body>& bodies, double G, double deltaTime, int width, int height, int steps,
+    const BlockTimestepConfig& config = BlockTimestepConfig(), BlockTimestepState* state = nullptr);
+
+// Barnes-Hut quadtree approximation. The tree is rebuilt every call from sorted
+// Morton keys; a cell is treated as a point mass when size / distance < theta.
+void CalculateForcesBarnesHut(std::vector<Body>& bodies, double G, double theta = 0.5);
+
+// Particle-mesh solver: CIC mass deposit on a gridSize^2 mesh over the bodies'
+// bounding box, FFT convolution with the pair force, CIC interpolation back.
+// With shortRange set the mesh only carries the smooth long-range part and the
+// rest is summed directly over cell lists (P3M).
+void CalculateForcesPM(std::vector<Body>& bodies, double G, int gridSize = 256, bool shortRange = false);
+
+// Fast multipole method on a uniform quadtree with Cartesian expansions of the
+// given order; accuracy rises with order at O(order^4) cost per cell pair.
+void CalculateForcesFMM(std::vector<Body>& bodies, double G, int order = 8);
+
 #endif // SIMULATION_HPP
@@ -0,0 +1,95 @@
+#include <SimulationContext.hpp>
+#include <new>
+#include <omp.h>
+#include <utility>
+
+static const std::size_t ARENA_ALIGNMENT = 64;
+
+static char* AllocateAligned(std::size_t bytes)
+{
+    return static_cast<char*>(::operator new(bytes, std::align_val_t(ARENA_ALIGNMENT)));
+}
+
+static void FreeAligned(char* p)
+{
+    ::operator delete(p, std::align_val_t(ARENA_ALIGNMENT));
+}
+
+ScratchArena::ScratchArena(ScratchArena&& other) noexcept
+    : block(std::exchange(other.block, nullptr))
+    , capacity(std::exchange(other.capacity, 0))
+    , used(std::exchange(other.used, 0))
+    , overflowBytes(std::exchange(other.overflowBytes, 0))
+    , overflow(std::move(other.overflow))
+{
+}
+
+ScratchArena::~ScratchArena()
+{
+    for (char* p : overflow)
+        FreeAligned(p);
+    if (block)
+        FreeAligned(block);
+}
+
+void* ScratchArena::AllocateBytes(std::size_t bytes)
+{
+    bytes = (bytes + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    if (used + bytes <= capacity) {
+        void* p = block + used;
+        used += bytes;
+        return p;
+    }
+    // Earlier allocations are still live, so the block cannot move yet.
+    char* p = AllocateAligned(bytes);
+    overflow.push_back(p);
+    overflowBytes += bytes;
+    return p;
+}
+
+void ScratchArena::Reset()
+{
+    if (!overflow.empty()) {
+        std::size_t demand = used + overflowBytes;
+        for (char* p : overflow)
+            FreeAligned(p);
+        overflow.clear();
+        overflowBytes = 0;
+        if (block)
+            FreeAligned(block);
+        block = AllocateAligned(demand);
+        capacity = demand;
+    }
+    used = 0;
+}
+
+Simulation::Simulation(std::vector<Body> bodies, double gravity, double deltaTime, int width, int height)
+    : bodies(std::move(bodies))
+    , gravity(gravity)
+    , deltaTime(deltaTime)
+    , width(width)
+    , height(height)
+{
+}
+
+void Simulation::BeginStep()
+{
+    const size_t n = bodies.size();
+    if (accelerations.size() != n) {
+        accelerations.resize(n);
+        ax.resize(n);
+        ay.resize(n);
+    }
+
+    const int threads = omp_get_max_threads();
+    if ((int)arenas.size() < threads)
+        arenas.resize(threads);
+    for (ScratchArena& arena : arenas)
+        arena.Reset();
+}
+
+Simulation& ScratchContext()
+{
+    static thread_local Simulation sim;
+    return sim;
+}
@@ -0,0 +1,81 @@
+#ifndef SIMULATION_CONTEXT_HPP
+#define SIMULATION_CONTEXT_HPP
+
+#include "Body.hpp"
+#include "BodySoA.hpp"
+#include <cstddef>
+#include <vector>
+
+// Per-thread bump allocator. Allocations are 64-byte aligned and stay valid
+// until the next Reset; when a step needs more than the block holds, the extra
+// comes from overflow blocks and the next Reset merges everything into one
+// block big enough for the whole step, so steady-state steps never allocate.
+// The arena itself is cache-line aligned so neighbouring threads' arenas never
+// share a line.
+class alignas(64) ScratchArena {
+public:
+    ScratchArena() = default;
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+    ScratchArena(ScratchArena&& other) noexcept;
+    ~ScratchArena();
+
+    // Uninitialized storage for count values of T.
+    template <typename T>
+    T* Allocate(std::size_t count)
+    {
+        return static_cast<T*>(AllocateBytes(count * sizeof(T)));
+    }
+    void Reset();
+
+    std::size_t Capacity() const { return capacity; }
+
+private:
+    void* AllocateBytes(std::size_t bytes);
+
+    char* block = nullptr;
+    std::size_t capacity = 0;
+    std::size_t used = 0;
+    std::size_t overflowBytes = 0;
+    std::vector<char*> overflow;
+};
+
+// Persistent state for one simulation: the bodies, the step parameters and
+// every buffer the engines need between and within steps, sized once and
+// reused for the rest of the run.
+struct Simulation {
+    std::vector<Body> bodies;
+    double gravity = 9.8;
+    double deltaTime = 0.07;
+    int width = 1920;
+    int height = 1080;
+
+    // Shared per-step scratch: one acceleration per body, plus a SoA copy for
+    // the vectorized engines.
+    std::vector<Vec2> accelerations;
+    AlignedVector<double> ax, ay;
+    BodySoA soa;
+    // Second SoA for engines that read one step's positions while writing the next's.
+    BodySoA nextSoa;
+    // Per-node copies of the j-side positions for SimulateNuma.
+    std::vector<BodySoA> replicas;
+
+    Simulation() = default;
+    Simulation(std::vector<Body> bodies, double gravity, double deltaTime, int width, int height);
+
+    // Sizes the shared buffers for the current body count, makes one arena per
+    // OpenMP thread and resets them all. Engines call this first.
+    void BeginStep();
+    // Arena of OpenMP thread t; only valid after BeginStep.
+    ScratchArena& Arena(int thread) { return arenas[thread]; }
+
+private:
+    std::vector<ScratchArena> arenas;
+};
+
+// Context kept per calling thread for the vector-based engine entry points:
+// they swap their bodies in, run the context engine and swap them back, so
+// repeated calls reuse its scratch too.
+Simulation& ScratchContext();
+
+#endif // SIMULATION_CONTEXT_HPP
@@ -0,0 +1,97 @@
+#include <BodySoA.hpp>
+#include <Simulation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <omp.h>
+
+static const int MIN_BLOCK_SIZE = 64;
+
+// Interactions between bodies of block [ib, ie) and block [jb, je), applied to both sides.
+static void BlockPair(const BodySoA& soa, int ib, int ie, int jb, int je, double G, double* ax, double* ay)
+{
+    const double* x = soa.x.data();
+    const double* y = soa.y.data();
+    const double* m = soa.mass.data();
+
+    for (int i = ib; i < ie; i++) {
+        const double xi = x[i];
+        const double yi = y[i];
+        const double mi = m[i];
+        double axi = 0, ayi = 0;
+
+#pragma omp simd reduction(+ : axi, ayi)
+        for (int j = jb; j < je; j++) {
+            double dx = x[j] - xi;
+            double dy = y[j] - yi;
+            double r2 = dx * dx + dy * dy;
+            double s = r2 < 1e-12 ? 0.0 : G / ((r2 + SOFTENING) * std::sqrt(r2));
+            axi += m[j] * s * dx;
+            ayi += m[j] * s * dy;
+            ax[j] -= mi * s * dx;
+            ay[j] -= mi * s * dy;
+        }
+
+        ax[i] += axi;
+        ay[i] += ayi;
+    }
+}
+
+// Unordered pairs inside one block.
+static void BlockSelf(const BodySoA& soa, int b, int e, double G, double* ax, double* ay)
+{
+    for (int i = b; i < e; i++) {
+        BlockPair(soa, i, i + 1, i + 1, e, G, ax, ay);
+    }
+}
+
+void CalculateForcesSymmetric(Simulation& sim)
+{
+    sim.BeginStep();
+    std::vector<Body>& bodies = sim.bodies;
+    const double G = sim.gravity;
+    const int n = bodies.size();
+    BodySoA& soa = sim.soa;
+    soa.Load(bodies);
+    AlignedVector<double>& ax = sim.ax;
+    AlignedVector<double>& ay = sim.ay;
+    std::fill(ax.begin(), ax.end(), 0.0);
+    std::fill(ay.begin(), ay.end(), 0.0);
+
+    // An even number of blocks, roughly two per thread, so each round of the
+    // schedule below keeps every thread busy.
+    int numBlocks = std::min(2 * omp_get_max_threads(), std::max(1, n / MIN_BLOCK_SIZE));
+    numBlocks += numBlocks & 1;
+    const int blockSize = (n + numBlocks - 1) / numBlocks;
+    auto blockBegin = [&](int b) { return std::min(n, b * blockSize); };
+
+#pragma omp parallel
+    {
+#pragma omp for schedule(dynamic)
+        for (int b = 0; b < numBlocks; b++) {
+            BlockSelf(soa, blockBegin(b), blockBegin(b + 1), G, ax.data(), ay.data());
+        }
+
+        // Round-robin tournament: in each round every block appears in exactly one
+        // pair, so the pairs of a round can run concurrently without any atomics.
+        for (int round = 0; round < numBlocks - 1; round++) {
+#pragma omp for schedule(dynamic)
+            for (int k = 0; k < numBlocks / 2; k++) {
+                int p, q;
+                if (k == 0) {
+                    p = round;
+                    q = numBlocks - 1;
+                } else {
+                    p = (round + k) % (numBlocks - 1);
+                    q = (round - k + numBlocks - 1) % (numBlocks - 1);
+                }
+                BlockPair(soa, blockBegin(p), blockBegin(p + 1), blockBegin(q), blockBegin(q + 1), G, ax.data(), ay.data());
+            }
+        }
+
+#pragma omp for
+        for (int i = 0; i < n; i++) {
+            bodies[i].velocity.x += ax[i];
+            bodies[i].velocity.y += ay[i];
+        }
+    }
+}
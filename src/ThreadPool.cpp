@@ -0,0 +1,180 @@
+#include <Numa.hpp>
+#include <ThreadPool.hpp>
+#include <algorithm>
+
+static const int DEQUE_CAPACITY = 1 << 16;
+static const int SPINS_BEFORE_YIELD = 1 << 12;
+static const int YIELDS_BEFORE_PARK = 1 << 10;
+
+WorkStealingDeque::WorkStealingDeque(int capacity)
+    : slots(capacity)
+    , mask(capacity - 1)
+{
+}
+
+bool WorkStealingDeque::Push(Range range)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t > mask)
+        return false;
+    slots[b & mask].store(Pack(range), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+bool WorkStealingDeque::Pop(Range& range)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    range = Unpack(slots[b & mask].load(std::memory_order_relaxed));
+    if (t == b) {
+        // Last element: race the thieves for it.
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+bool WorkStealingDeque::Steal(Range& range)
+{
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return false;
+
+    range = Unpack(slots[t & mask].load(std::memory_order_relaxed));
+    return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+}
+
+ThreadPool::ThreadPool(int threads, bool pin)
+    : threads(std::max(1, threads))
+{
+    for (int id = 0; id < this->threads; id++)
+        deques.push_back(std::make_unique<WorkStealingDeque>(DEQUE_CAPACITY));
+
+    for (int id = 1; id < this->threads; id++) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this, id);
+        if (pin)
+            PinThread(workers.back().native_handle(), CpuForThread(id, GetAffinity() == Affinity::None ? Affinity::Compact : GetAffinity()));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    stopping = true;
+    StartPhase();
+    for (std::thread& t : workers)
+        t.join();
+}
+
+// Publishes a new generation. Both sides use seq_cst, so either a parking
+// worker sees the new generation or this sees it among the sleepers.
+void ThreadPool::StartPhase()
+{
+    generation.fetch_add(1, std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_seq_cst) > 0) {
+        // Taking the lock waits out a worker between its check and its wait.
+        std::lock_guard<std::mutex> lock(parkLock);
+        parked.notify_all();
+    }
+}
+
+void ThreadPool::WorkerLoop(int id)
+{
+    uint64_t seen = 0;
+    for (;;) {
+        int spins = 0;
+        uint64_t g;
+        while ((g = generation.load(std::memory_order_acquire)) == seen) {
+            if (++spins <= SPINS_BEFORE_YIELD)
+                continue;
+            if (spins <= SPINS_BEFORE_YIELD + YIELDS_BEFORE_PARK) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(parkLock);
+            sleepers.fetch_add(1, std::memory_order_seq_cst);
+            parked.wait(lock, [&] { return generation.load(std::memory_order_seq_cst) != seen; });
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+        seen = g;
+        if (stopping)
+            return;
+        RunPhase(id);
+    }
+}
+
+void ThreadPool::RunPhase(int id)
+{
+    const int chunks = (jobSize + jobGrain - 1) / jobGrain;
+    WorkStealingDeque& own = *deques[id];
+
+    // Seed our own deque with a contiguous share of the chunks, pushed in reverse
+    // so the owner pops them in ascending order.
+    int first = (int)((int64_t)chunks * id / threads);
+    int last = (int)((int64_t)chunks * (id + 1) / threads);
+    for (int c = last - 1; c >= first; c--)
+        own.Push({ c * jobGrain, std::min(jobSize, (c + 1) * jobGrain) });
+
+    WorkStealingDeque::Range range;
+    for (;;) {
+        while (own.Pop(range))
+            (*job)(range.begin, range.end);
+
+        bool stole = false;
+        for (int k = 1; k < threads && !stole; k++) {
+            if (deques[(id + k) % threads]->Steal(range)) {
+                (*job)(range.begin, range.end);
+                stole = true;
+            }
+        }
+        if (!stole)
+            break;
+    }
+
+    pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void ThreadPool::ParallelFor(int n, int grain, const std::function<void(int, int)>& body)
+{
+    if (n <= 0)
+        return;
+
+    job = &body;
+    jobSize = n;
+    // Each worker's contiguous share has to fit its deque, or Push would drop chunks.
+    const int64_t shareLimit = (int64_t)threads * DEQUE_CAPACITY;
+    jobGrain = std::max({ 1, grain, (int)((n + shareLimit - 1) / shareLimit) });
+    pending.store(threads, std::memory_order_relaxed);
+    StartPhase();
+
+    RunPhase(0);
+
+    // Phase barrier: a worker only leaves once no deque it could steal from has
+    // work, so when everyone has checked out the whole range is done.
+    int spins = 0;
+    while (pending.load(std::memory_order_acquire) != 0) {
+        if (++spins > SPINS_BEFORE_YIELD)
+            std::this_thread::yield();
+    }
+}
+
+ThreadPool& SharedThreadPool(int threads)
+{
+    static std::unique_ptr<ThreadPool> pool;
+    if (!pool || pool->Size() != threads)
+        pool = std::make_unique<ThreadPool>(threads);
+    return *pool;
+}
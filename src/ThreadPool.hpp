@@ -0,0 +1,81 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-capacity Chase-Lev deque of index ranges. Only the owning worker may
+// Push/Pop (at the bottom); any worker may Steal from the top. Indices grow
+// monotonically across phases and wrap around the ring.
+class WorkStealingDeque {
+public:
+    struct Range {
+        int begin, end;
+    };
+
+    explicit WorkStealingDeque(int capacity);
+
+    bool Push(Range range);
+    bool Pop(Range& range);
+    bool Steal(Range& range);
+
+private:
+    static uint64_t Pack(Range r) { return ((uint64_t)(uint32_t)r.begin << 32) | (uint32_t)r.end; }
+    static Range Unpack(uint64_t v) { return { (int)(v >> 32), (int)(uint32_t)v }; }
+
+    std::vector<std::atomic<uint64_t>> slots;
+    int64_t mask;
+    alignas(64) std::atomic<int64_t> top { 0 };
+    alignas(64) std::atomic<int64_t> bottom { 0 };
+};
+
+// Persistent pool of (optionally core-pinned) workers. The calling thread acts as
+// worker 0, so a pool of n threads starts n - 1 extra threads. Between phases
+// workers spin briefly, then yield, then sleep until the next phase; they are
+// never torn down until the pool is.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads, bool pin = true);
+    ~ThreadPool();
+
+    int Size() const { return threads; }
+
+    // Runs body(begin, end) over [0, n) in chunks of `grain`, made larger if a
+    // worker's share of chunks would not fit its deque. Each worker seeds
+    // its own deque with a contiguous share of chunks, then steals from the
+    // others once its share runs out. Returns when every chunk has finished.
+    void ParallelFor(int n, int grain, const std::function<void(int, int)>& body);
+
+private:
+    void WorkerLoop(int id);
+    void RunPhase(int id);
+    void StartPhase();
+
+    int threads;
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkStealingDeque>> deques;
+
+    const std::function<void(int, int)>* job = nullptr;
+    int jobSize = 0;
+    int jobGrain = 1;
+
+    alignas(64) std::atomic<uint64_t> generation { 0 };
+    alignas(64) std::atomic<int> pending { 0 }; // workers still inside the phase
+    std::atomic<bool> stopping { false };
+
+    // Workers that ran out of spins sleep here until generation moves on.
+    std::mutex parkLock;
+    std::condition_variable parked;
+    std::atomic<int> sleepers { 0 };
+};
+
+// Pool shared by the pooled engine, rebuilt whenever the thread count changes.
+ThreadPool& SharedThreadPool(int threads);
+
+#endif // THREAD_POOL_HPP
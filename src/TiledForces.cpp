@@ -0,0 +1,157 @@
+#include <BodySoA.hpp>
+#include <ForceLaw.hpp>
+#include <Simulation.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <omp.h>
+#include <unistd.h>
+
+static const int BYTES_PER_J_BODY = 3 * sizeof(double); // x, y, mass
+static const int I_UNROLL = 4;
+
+static TileConfig activeTileConfig = { 0, 0 };
+
+static long CacheSize(int name, long fallback)
+{
+    long size = sysconf(name);
+    return size > 0 ? size : fallback;
+}
+
+TileConfig DetectTileConfig()
+{
+    TileConfig config;
+
+    // The j-tile takes half of L1 so the i accumulators and stack stay resident;
+    // the i-block is sized so its rows plus one j-tile fit in a quarter of L2.
+    long l1 = CacheSize(_SC_LEVEL1_DCACHE_SIZE, 32 * 1024);
+    long l2 = CacheSize(_SC_LEVEL2_CACHE_SIZE, 256 * 1024);
+    config.jTile = std::max(64L, l1 / 2 / BYTES_PER_J_BODY) & ~7L;
+    config.iBlock = std::max((long)I_UNROLL * 16, l2 / 4 / (4 * (long)sizeof(double))) & ~(long)(I_UNROLL - 1);
+
+    // NBODY_TILE=<iBlock>x<jTile> overrides the detected values for tuning runs.
+    if (const char* env = std::getenv("NBODY_TILE")) {
+        int iBlock = 0, jTile = 0;
+        if (std::sscanf(env, "%dx%d", &iBlock, &jTile) == 2 && iBlock > 0 && jTile > 0) {
+            config.iBlock = (iBlock + I_UNROLL - 1) / I_UNROLL * I_UNROLL;
+            config.jTile = jTile;
+        }
+    }
+    return config;
+}
+
+TileConfig GetTileConfig()
+{
+    if (activeTileConfig.iBlock <= 0 || activeTileConfig.jTile <= 0)
+        activeTileConfig = DetectTileConfig();
+    return activeTileConfig;
+}
+
+void SetTileConfig(TileConfig config)
+{
+    if (config.iBlock > 0)
+        config.iBlock = (config.iBlock + I_UNROLL - 1) / I_UNROLL * I_UNROLL;
+    activeTileConfig = config;
+}
+
+// Four i-bodies against one j-tile, with all eight accumulators kept in registers.
+template <typename Law>
+static void TileRow4(const double* x, const double* y, const double* m, int jb, int je, const double* xi, const double* yi, double G, double* ax, double* ay,
+    const Law& law)
+{
+    double ax0 = 0, ax1 = 0, ax2 = 0, ax3 = 0;
+    double ay0 = 0, ay1 = 0, ay2 = 0, ay3 = 0;
+    const double x0 = xi[0], x1 = xi[1], x2 = xi[2], x3 = xi[3];
+    const double y0 = yi[0], y1 = yi[1], y2 = yi[2], y3 = yi[3];
+
+#pragma omp simd reduction(+ : ax0, ax1, ax2, ax3, ay0, ay1, ay2, ay3)
+    for (int j = jb; j < je; j++) {
+        const double xj = x[j], yj = y[j], gm = G * m[j];
+        double dx, dy, r2, s;
+
+        dx = xj - x0, dy = yj - y0, r2 = dx * dx + dy * dy;
+        s = law(r2, gm);
+        ax0 += dx * s, ay0 += dy * s;
+
+        dx = xj - x1, dy = yj - y1, r2 = dx * dx + dy * dy;
+        s = law(r2, gm);
+        ax1 += dx * s, ay1 += dy * s;
+
+        dx = xj - x2, dy = yj - y2, r2 = dx * dx + dy * dy;
+        s = law(r2, gm);
+        ax2 += dx * s, ay2 += dy * s;
+
+        dx = xj - x3, dy = yj - y3, r2 = dx * dx + dy * dy;
+        s = law(r2, gm);
+        ax3 += dx * s, ay3 += dy * s;
+    }
+
+    ax[0] += ax0, ax[1] += ax1, ax[2] += ax2, ax[3] += ax3;
+    ay[0] += ay0, ay[1] += ay1, ay[2] += ay2, ay[3] += ay3;
+}
+
+template <typename Law>
+void CalculateForcesTiled(Simulation& sim, const Law& law)
+{
+    sim.BeginStep();
+    std::vector<Body>& bodies = sim.bodies;
+    const double G = sim.gravity;
+    const int n = bodies.size();
+    const TileConfig config = GetTileConfig();
+
+    BodySoA& soa = sim.soa;
+    soa.Load(bodies);
+    const double* x = soa.x.data();
+    const double* y = soa.y.data();
+    const double* m = soa.mass.data();
+
+    // The cache-derived i-block can cover every N we run, so shrink it until
+    // each thread has at least two blocks to take.
+    const int perBlock = (n + 2 * omp_get_max_threads() - 1) / (2 * omp_get_max_threads());
+    const int iBlock = std::max(I_UNROLL, std::min(config.iBlock, (perBlock + I_UNROLL - 1) / I_UNROLL * I_UNROLL));
+
+    // Positions and accumulators of an i-block are padded to a multiple of four so
+    // the unrolled row kernel never needs a remainder loop. Padded rows are
+    // placed far away and their results are discarded.
+    const int numBlocks = (n + iBlock - 1) / iBlock;
+
+#pragma omp parallel
+    {
+        ScratchArena& arena = sim.Arena(omp_get_thread_num());
+        double* bx = arena.Allocate<double>(iBlock);
+        double* by = arena.Allocate<double>(iBlock);
+        double* bax = arena.Allocate<double>(iBlock);
+        double* bay = arena.Allocate<double>(iBlock);
+
+#pragma omp for schedule(dynamic)
+        for (int block = 0; block < numBlocks; block++) {
+            const int ib = block * iBlock;
+            const int ie = std::min(n, ib + iBlock);
+            const int rows = (ie - ib + I_UNROLL - 1) / I_UNROLL * I_UNROLL;
+
+            for (int r = 0; r < rows; r++) {
+                bx[r] = ib + r < ie ? x[ib + r] : 1e300;
+                by[r] = ib + r < ie ? y[ib + r] : 1e300;
+                bax[r] = 0;
+                bay[r] = 0;
+            }
+
+            for (int jb = 0; jb < n; jb += config.jTile) {
+                const int je = std::min(n, jb + config.jTile);
+                for (int r = 0; r < rows; r += I_UNROLL) {
+                    TileRow4(x, y, m, jb, je, &bx[r], &by[r], G, &bax[r], &bay[r], law);
+                }
+            }
+
+            for (int i = ib; i < ie; i++) {
+                bodies[i].velocity.x += bax[i - ib];
+                bodies[i].velocity.y += bay[i - ib];
+            }
+        }
+    }
+}
+
+template void CalculateForcesTiled(Simulation&, const SoftenedGravity&);
+template void CalculateForcesTiled(Simulation&, const Plummer&);
+template void CalculateForcesTiled(Simulation&, const Cutoff<SoftenedGravity>&);
@@ -0,0 +1,216 @@
+#include <Trace.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <memory>
+#include <mutex>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    int64_t start; // microseconds since tracing started
+    int64_t duration;
+    bool hasCounters;
+    uint64_t counters[TRACE_COUNTERS];
+};
+
+struct ThreadTrace {
+    int tid;
+    std::vector<int> counterFds; // perf group, leader first; empty when unavailable
+    std::vector<TraceEvent> events;
+};
+
+const char* COUNTER_NAMES[TRACE_COUNTERS] = { "cycles", "instructions", "cache_misses", "branch_misses" };
+const uint64_t COUNTER_CONFIGS[TRACE_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+std::atomic<bool> enabled { false };
+std::atomic<bool> countersWanted { false };
+std::atomic<bool> countersFailed { false };
+std::chrono::steady_clock::time_point origin;
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<ThreadTrace>> registry;
+
+int64_t Now()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+int OpenCounter(uint64_t config, int groupFd)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = groupFd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+void CloseCounterGroup(std::vector<int>& fds)
+{
+    for (int fd : fds)
+        close(fd);
+    fds.clear();
+}
+
+// Opens the four counters as one group for the calling thread.
+bool OpenCounterGroup(std::vector<int>& fds)
+{
+    for (int c = 0; c < TRACE_COUNTERS; c++) {
+        int fd = OpenCounter(COUNTER_CONFIGS[c], fds.empty() ? -1 : fds[0]);
+        if (fd < 0) {
+            CloseCounterGroup(fds);
+            return false;
+        }
+        fds.push_back(fd);
+    }
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+}
+
+// The counters only measure their own thread, so they are closed when it
+// exits; its recorded events stay in the registry for WriteTrace.
+struct CounterOwner {
+    ThreadTrace* trace = nullptr;
+    ~CounterOwner()
+    {
+        if (trace)
+            CloseCounterGroup(trace->counterFds);
+    }
+};
+
+ThreadTrace& CurrentThread()
+{
+    thread_local ThreadTrace* trace = nullptr;
+    thread_local CounterOwner owner;
+    if (!trace) {
+        auto owned = std::make_unique<ThreadTrace>();
+        owned->tid = syscall(SYS_gettid);
+        if (countersWanted) {
+            if (OpenCounterGroup(owned->counterFds))
+                owner.trace = owned.get();
+            else
+                countersFailed = true;
+        }
+        trace = owned.get();
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.push_back(std::move(owned));
+    }
+    return *trace;
+}
+
+bool ReadCounters(const ThreadTrace& thread, uint64_t* out)
+{
+    if (thread.counterFds.empty())
+        return false;
+    uint64_t buffer[1 + TRACE_COUNTERS];
+    if (read(thread.counterFds[0], buffer, sizeof(buffer)) != sizeof(buffer))
+        return false;
+    std::memcpy(out, buffer + 1, sizeof(uint64_t) * TRACE_COUNTERS);
+    return true;
+}
+
+} // namespace
+
+void StartTracing(bool hardwareCounters)
+{
+    origin = std::chrono::steady_clock::now();
+    countersWanted = hardwareCounters;
+    countersFailed = false;
+    enabled = true;
+}
+
+void StopTracing()
+{
+    enabled = false;
+}
+
+bool TracingEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+bool HardwareCountersAvailable()
+{
+    return countersWanted && !countersFailed;
+}
+
+TraceSpan::TraceSpan(const char* name, const char* category)
+    : name(name)
+    , category(category)
+    , active(TracingEnabled())
+{
+    if (!active)
+        return;
+    ReadCounters(CurrentThread(), counters);
+    start = Now();
+}
+
+TraceSpan::~TraceSpan()
+{
+    if (!active)
+        return;
+
+    int64_t end = Now();
+    ThreadTrace& thread = CurrentThread();
+
+    TraceEvent event;
+    event.name = name;
+    event.category = category;
+    event.start = start;
+    event.duration = end - start;
+    uint64_t now[TRACE_COUNTERS];
+    event.hasCounters = ReadCounters(thread, now);
+    for (int c = 0; c < TRACE_COUNTERS; c++)
+        event.counters[c] = event.hasCounters ? now[c] - counters[c] : 0;
+    thread.events.push_back(event);
+}
+
+bool WriteTrace(const std::string& path)
+{
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "Could not open trace %s for writing\n", path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    const int pid = getpid();
+    bool first = true;
+
+    fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (const auto& thread : registry) {
+        for (const TraceEvent& e : thread->events) {
+            fprintf(f, "%s  {\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %lld, \"dur\": %lld, \"pid\": %d, \"tid\": %d",
+                first ? "" : ",\n", e.name, e.category, (long long)e.start, (long long)e.duration, pid, thread->tid);
+            if (e.hasCounters) {
+                fprintf(f, ", \"args\": {");
+                for (int c = 0; c < TRACE_COUNTERS; c++)
+                    fprintf(f, "%s\"%s\": %llu", c ? ", " : "", COUNTER_NAMES[c], (unsigned long long)e.counters[c]);
+                fprintf(f, "}");
+            }
+            fprintf(f, "}");
+            first = false;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Lightweight phase tracing. While tracing is enabled every TraceSpan records a
+// complete event for the calling thread; WriteTrace dumps them as Chrome /
+// Perfetto trace JSON. When counters are requested, each span also carries the
+// hardware counter deltas (cycles, instructions, cache misses, branch misses)
+// for its thread, read through perf_event_open.
+
+const int TRACE_COUNTERS = 4;
+
+void StartTracing(bool hardwareCounters);
+void StopTracing();
+bool TracingEnabled();
+// False when counters were requested but the kernel refused them.
+bool HardwareCountersAvailable();
+bool WriteTrace(const std::string& path);
+
+class TraceSpan {
+public:
+    TraceSpan(const char* name, const char* category);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name;
+    const char* category;
+    bool active;
+    int64_t start;
+    uint64_t counters[TRACE_COUNTERS];
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name, category) TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name, category)
+
+#endif // TRACE_HPP
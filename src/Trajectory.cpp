@@ -0,0 +1,245 @@
+#include <Trajectory.hpp>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t ScalarSize(uint32_t flags)
+{
+    return (flags & TRAJECTORY_QUANTIZED) ? sizeof(float) : sizeof(double);
+}
+
+static size_t BlockSize(const TrajectoryHeader& header)
+{
+    return sizeof(uint64_t) + 5 * header.bodyCount * ScalarSize(header.flags);
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& path, int bodyCount, double deltaTime, bool quantize)
+{
+    Create(path, bodyCount, deltaTime, quantize);
+}
+
+void TrajectoryWriter::Create(const std::string& path, int bodyCount, double deltaTime, bool quantize)
+{
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic));
+    header.version = 1;
+    header.flags = quantize ? TRAJECTORY_QUANTIZED : 0;
+    header.bodyCount = bodyCount;
+    header.deltaTime = deltaTime;
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+        fprintf(stderr, "Could not open trajectory %s for writing\n", path.c_str());
+        return;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    block.resize(BlockSize(header));
+}
+
+TrajectoryWriter::TrajectoryWriter(const std::string& path, int bodyCount, double deltaTime, bool quantize, uint64_t lastStep)
+{
+    file = fopen(path.c_str(), "r+b");
+    if (!file) {
+        Create(path, bodyCount, deltaTime, quantize);
+        return;
+    }
+
+    struct stat st;
+    if (fread(&header, sizeof(header), 1, file) != 1 || std::memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic)) != 0
+        || header.bodyCount != (uint64_t)bodyCount || fstat(fileno(file), &st) != 0) {
+        fprintf(stderr, "Trajectory %s does not match this run; not appending\n", path.c_str());
+        fclose(file);
+        file = nullptr;
+        return;
+    }
+    block.resize(BlockSize(header));
+
+    // Keep the complete blocks up to lastStep; step numbers only increase.
+    uint64_t keep = (st.st_size - sizeof(header)) / block.size();
+    while (keep > 0) {
+        uint64_t step;
+        if (fseek(file, sizeof(header) + (keep - 1) * block.size(), SEEK_SET) != 0 || fread(&step, sizeof(step), 1, file) != 1)
+            break;
+        if (step <= lastStep)
+            break;
+        keep--;
+    }
+    const off_t end = sizeof(header) + keep * block.size();
+    if (ftruncate(fileno(file), end) != 0 || fseek(file, end, SEEK_SET) != 0) {
+        fprintf(stderr, "Could not reopen trajectory %s for appending\n", path.c_str());
+        fclose(file);
+        file = nullptr;
+        return;
+    }
+    header.stepCount = keep;
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    Close();
+}
+
+template <typename T>
+static void PackComponents(const std::vector<Body>& bodies, unsigned char* out)
+{
+    const size_t n = bodies.size();
+    T* x = reinterpret_cast<T*>(out);
+    T* y = x + n;
+    T* vx = y + n;
+    T* vy = vx + n;
+    T* m = vy + n;
+    for (size_t i = 0; i < n; i++) {
+        x[i] = (T)bodies[i].position.x;
+        y[i] = (T)bodies[i].position.y;
+        vx[i] = (T)bodies[i].velocity.x;
+        vy[i] = (T)bodies[i].velocity.y;
+        m[i] = (T)bodies[i].mass;
+    }
+}
+
+bool TrajectoryWriter::Append(const std::vector<Body>& bodies, uint64_t step)
+{
+    if (!file || bodies.size() != header.bodyCount)
+        return false;
+
+    std::memcpy(block.data(), &step, sizeof(step));
+    if (header.flags & TRAJECTORY_QUANTIZED)
+        PackComponents<float>(bodies, block.data() + sizeof(step));
+    else
+        PackComponents<double>(bodies, block.data() + sizeof(step));
+
+    if (fwrite(block.data(), block.size(), 1, file) != 1)
+        return false;
+    header.stepCount++;
+    return true;
+}
+
+bool TrajectoryWriter::Close(bool sync)
+{
+    if (!file)
+        return false;
+    // Patch the final step count into the header.
+    bool ok = fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1 && fflush(file) == 0;
+    if (sync)
+        ok = ok && fsync(fileno(file)) == 0;
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+TrajectoryReader::TrajectoryReader(const std::string& path)
+{
+    std::memset(&header, 0, sizeof(header));
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Could not open trajectory %s\n", path.c_str());
+        return;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TrajectoryHeader)) {
+        fprintf(stderr, "Trajectory %s is truncated\n", path.c_str());
+        close(fd);
+        return;
+    }
+
+    void* mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return;
+
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, TRAJECTORY_MAGIC, sizeof(header.magic)) != 0) {
+        fprintf(stderr, "%s is not a trajectory file\n", path.c_str());
+        munmap(mapping, st.st_size);
+        return;
+    }
+
+    data = static_cast<const unsigned char*>(mapping);
+    size = st.st_size;
+    // Trust the file length over the header so a run that died before Close()
+    // can still be replayed up to its last complete block.
+    steps = (size - sizeof(TrajectoryHeader)) / BlockSize(header);
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+    if (data)
+        munmap((void*)data, size);
+}
+
+uint64_t TrajectoryReader::StepNumber(int k) const
+{
+    uint64_t step;
+    std::memcpy(&step, data + sizeof(TrajectoryHeader) + k * BlockSize(header), sizeof(step));
+    return step;
+}
+
+const void* TrajectoryReader::Component(int k, int component) const
+{
+    return data + sizeof(TrajectoryHeader) + k * BlockSize(header) + sizeof(uint64_t)
+        + component * header.bodyCount * ScalarSize(header.flags);
+}
+
+template <typename T>
+static void UnpackComponents(const TrajectoryReader& reader, int k, std::vector<Body>& bodies)
+{
+    const T* x = static_cast<const T*>(reader.Component(k, 0));
+    const T* y = static_cast<const T*>(reader.Component(k, 1));
+    const T* vx = static_cast<const T*>(reader.Component(k, 2));
+    const T* vy = static_cast<const T*>(reader.Component(k, 3));
+    const T* m = static_cast<const T*>(reader.Component(k, 4));
+    for (size_t i = 0; i < bodies.size(); i++) {
+        bodies[i].position = { x[i], y[i] };
+        bodies[i].velocity = { vx[i], vy[i] };
+        bodies[i].mass = m[i];
+    }
+}
+
+void TrajectoryReader::Read(int k, std::vector<Body>& bodies) const
+{
+    bodies.resize(header.bodyCount);
+    if (Quantized())
+        UnpackComponents<float>(*this, k, bodies);
+    else
+        UnpackComponents<double>(*this, k, bodies);
+}
+
+bool SaveCheckpoint(const std::string& path, const std::vector<Body>& bodies, uint64_t step, double deltaTime)
+{
+    // Write and sync a temporary file, then rename it over the old checkpoint and
+    // sync the directory, so a crash leaves either the old or the new one whole.
+    std::string tmp = path + ".tmp";
+    TrajectoryWriter writer(tmp, bodies.size(), deltaTime);
+    if (!writer.IsOpen() || !writer.Append(bodies, step) || !writer.Close(true)) {
+        fprintf(stderr, "Could not write checkpoint %s\n", tmp.c_str());
+        return false;
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        fprintf(stderr, "Could not replace checkpoint %s\n", path.c_str());
+        return false;
+    }
+
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+bool LoadCheckpoint(const std::string& path, std::vector<Body>& bodies, uint64_t& step)
+{
+    TrajectoryReader reader(path);
+    if (!reader.IsOpen() || reader.Steps() < 1)
+        return false;
+    int last = reader.Steps() - 1;
+    reader.Read(last, bodies);
+    step = reader.StepNumber(last);
+    return true;
+}
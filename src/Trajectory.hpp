@@ -0,0 +1,80 @@
+#ifndef TRAJECTORY_HPP
+#define TRAJECTORY_HPP
+
+#include "Body.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Binary trajectory layout:
+//   TrajectoryHeader
+//   step block 0, step block 1, ...
+// A step block is a uint64 step number followed by the x, y, vx, vy and mass
+// arrays for every body, stored as double, or as float when the file is
+// quantized. All blocks have the same size so step k is found by offset.
+// A checkpoint is simply a full-precision trajectory holding a single block.
+
+const char TRAJECTORY_MAGIC[8] = { 'N', 'B', 'T', 'R', 'A', 'J', '0', '1' };
+const uint32_t TRAJECTORY_QUANTIZED = 1;
+
+struct TrajectoryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t bodyCount;
+    uint64_t stepCount;
+    double deltaTime;
+    double reserved[3];
+};
+
+class TrajectoryWriter {
+public:
+    TrajectoryWriter(const std::string& path, int bodyCount, double deltaTime, bool quantize = false);
+    // Continues an existing trajectory instead, keeping its precision. Blocks
+    // past lastStep, written after the checkpoint being resumed, and a torn
+    // final block are cut off. Starts a new file when there is none.
+    TrajectoryWriter(const std::string& path, int bodyCount, double deltaTime, bool quantize, uint64_t lastStep);
+    ~TrajectoryWriter();
+
+    bool IsOpen() const { return file != nullptr; }
+    bool Append(const std::vector<Body>& bodies, uint64_t step);
+    // With sync set, the data is on disk before this returns true.
+    bool Close(bool sync = false);
+
+private:
+    void Create(const std::string& path, int bodyCount, double deltaTime, bool quantize);
+
+    FILE* file = nullptr;
+    TrajectoryHeader header;
+    std::vector<unsigned char> block;
+};
+
+class TrajectoryReader {
+public:
+    explicit TrajectoryReader(const std::string& path);
+    ~TrajectoryReader();
+
+    bool IsOpen() const { return data != nullptr; }
+    int BodyCount() const { return header.bodyCount; }
+    int Steps() const { return steps; }
+    double DeltaTime() const { return header.deltaTime; }
+    bool Quantized() const { return header.flags & TRAJECTORY_QUANTIZED; }
+
+    uint64_t StepNumber(int k) const;
+    // Pointers into the mapping for step k; component is 0..4 for x, y, vx, vy, mass.
+    // Element type is float for quantized files and double otherwise.
+    const void* Component(int k, int component) const;
+    void Read(int k, std::vector<Body>& bodies) const;
+
+private:
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    TrajectoryHeader header;
+    int steps = 0;
+};
+
+bool SaveCheckpoint(const std::string& path, const std::vector<Body>& bodies, uint64_t step, double deltaTime);
+bool LoadCheckpoint(const std::string& path, std::vector<Body>& bodies, uint64_t& step);
+
+#endif // TRAJECTORY_HPP
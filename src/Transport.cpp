@@ -0,0 +1,236 @@
+#include <Transport.hpp>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+bool ParseTransport(const std::string& name, TransportKind& kind)
+{
+    if (name == "shm")
+        kind = TransportKind::SharedMemory;
+    else if (name == "socket")
+        kind = TransportKind::Socket;
+    else
+        return false;
+    return true;
+}
+
+// Mailbox of one receiving rank. The sender may run one message ahead of the
+// receiver, so there are two slots; the counters live on separate lines.
+struct alignas(64) Mailbox {
+    std::atomic<uint64_t> written;
+    alignas(64) std::atomic<uint64_t> consumed;
+};
+
+struct SharedRegion {
+    char* base = nullptr;
+    std::size_t bytes = 0;
+    std::size_t slotBytes = 0;
+
+    ~SharedRegion()
+    {
+        if (base)
+            munmap(base, bytes);
+    }
+
+    std::size_t MailboxBytes() const { return sizeof(Mailbox) + 2 * slotBytes; }
+    Mailbox* Box(int rank) const { return reinterpret_cast<Mailbox*>(base + rank * MailboxBytes()); }
+    char* Slot(int rank, uint64_t sequence) const { return base + rank * MailboxBytes() + sizeof(Mailbox) + (sequence & 1) * slotBytes; }
+};
+
+// Ranks usually outnumber idle cores, so the core is given away quickly, and
+// once yielding the peers are checked now and then so a dead rank cannot leave
+// the others waiting forever.
+template <typename Ready>
+static bool WaitUntil(Ready ready, const std::function<bool()>& peersAlive)
+{
+    for (int spin = 0; !ready(); spin++) {
+        if (spin < 64)
+            continue;
+        sched_yield();
+        if (spin % 1024 == 0 && peersAlive && !peersAlive())
+            return false;
+    }
+    return true;
+}
+
+class SharedMemoryTransport : public RingTransport {
+public:
+    SharedMemoryTransport(std::shared_ptr<SharedRegion> region, int rank, int ranks)
+        : region(std::move(region))
+    {
+        this->rank = rank;
+        this->ranks = ranks;
+    }
+
+    bool StartSend(const void* data, std::size_t bytes) override
+    {
+        if (bytes > region->slotBytes)
+            return false;
+        const int next = (rank + 1) % ranks;
+        Mailbox* box = region->Box(next);
+        if (!WaitUntil([&] { return sent - box->consumed.load(std::memory_order_acquire) < 2; }, peersAlive))
+            return false;
+        std::memcpy(region->Slot(next, sent), data, bytes);
+        box->written.store(++sent, std::memory_order_release);
+        return true;
+    }
+
+    bool WaitSend() override { return true; }
+
+    bool Receive(void* data, std::size_t bytes) override
+    {
+        if (bytes > region->slotBytes)
+            return false;
+        Mailbox* box = region->Box(rank);
+        if (!WaitUntil([&] { return box->written.load(std::memory_order_acquire) > received; }, peersAlive))
+            return false;
+        std::memcpy(data, region->Slot(rank, received), bytes);
+        box->consumed.store(++received, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::shared_ptr<SharedRegion> region;
+    uint64_t sent = 0;
+    uint64_t received = 0;
+};
+
+static std::shared_ptr<SharedRegion> CreateSharedRegion(int ranks, std::size_t maxMessage)
+{
+    static std::atomic<int> counter { 0 };
+    char name[64];
+    snprintf(name, sizeof(name), "/nbody-ring-%d-%d", (int)getpid(), counter++);
+
+    auto region = std::make_shared<SharedRegion>();
+    region->slotBytes = (maxMessage + 63) & ~(std::size_t)63;
+    region->bytes = ranks * region->MailboxBytes();
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "shm_open %s: %s\n", name, strerror(errno));
+        return nullptr;
+    }
+    // The mapping is inherited across fork, so the name is not needed past here.
+    shm_unlink(name);
+    if (ftruncate(fd, region->bytes) != 0) {
+        fprintf(stderr, "ftruncate %s: %s\n", name, strerror(errno));
+        close(fd);
+        return nullptr;
+    }
+    void* base = mmap(nullptr, region->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "mmap %s: %s\n", name, strerror(errno));
+        return nullptr;
+    }
+    region->base = static_cast<char*>(base);
+    for (int r = 0; r < ranks; r++)
+        new (region->Box(r)) Mailbox { { 0 }, { 0 } };
+    return region;
+}
+
+class SocketTransport : public RingTransport {
+public:
+    SocketTransport(int sendFd, int receiveFd, int rank, int ranks)
+        : sendFd(sendFd)
+        , receiveFd(receiveFd)
+    {
+        this->rank = rank;
+        this->ranks = ranks;
+    }
+
+    ~SocketTransport() override
+    {
+        WaitSend();
+        close(sendFd);
+        close(receiveFd);
+    }
+
+    // The write runs on a helper thread so a block larger than the socket
+    // buffer does not stall the ring while every rank is sending.
+    bool StartSend(const void* data, std::size_t bytes) override
+    {
+        if (!WaitSend())
+            return false;
+        sender = std::thread([this, data, bytes] {
+            const char* p = static_cast<const char*>(data);
+            std::size_t left = bytes;
+            while (left > 0) {
+                ssize_t n = send(sendFd, p, left, MSG_NOSIGNAL);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n <= 0) {
+                    sendFailed = true;
+                    return;
+                }
+                p += n;
+                left -= n;
+            }
+        });
+        return true;
+    }
+
+    bool WaitSend() override
+    {
+        if (sender.joinable())
+            sender.join();
+        return !sendFailed;
+    }
+
+    bool Receive(void* data, std::size_t bytes) override
+    {
+        char* p = static_cast<char*>(data);
+        while (bytes > 0) {
+            ssize_t n = recv(receiveFd, p, bytes, 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            p += n;
+            bytes -= n;
+        }
+        return true;
+    }
+
+private:
+    int sendFd, receiveFd;
+    std::thread sender;
+    bool sendFailed = false;
+};
+
+std::vector<std::unique_ptr<RingTransport>> CreateRing(TransportKind kind, int ranks, std::size_t maxMessage)
+{
+    std::vector<std::unique_ptr<RingTransport>> ring;
+    if (kind == TransportKind::SharedMemory) {
+        std::shared_ptr<SharedRegion> region = CreateSharedRegion(ranks, maxMessage);
+        if (!region)
+            return ring;
+        for (int r = 0; r < ranks; r++)
+            ring.push_back(std::make_unique<SharedMemoryTransport>(region, r, ranks));
+        return ring;
+    }
+
+    // Link r carries rank r's messages to rank r + 1.
+    std::vector<int> links(2 * ranks, -1);
+    for (int r = 0; r < ranks; r++) {
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, &links[2 * r]) != 0) {
+            fprintf(stderr, "socketpair: %s\n", strerror(errno));
+            for (int fd : links)
+                if (fd >= 0)
+                    close(fd);
+            return ring;
+        }
+    }
+    for (int r = 0; r < ranks; r++)
+        ring.push_back(std::make_unique<SocketTransport>(links[2 * r], links[2 * ((r + ranks - 1) % ranks) + 1], r, ranks));
+    return ring;
+}
@@ -0,0 +1,40 @@
+#ifndef TRANSPORT_HPP
+#define TRANSPORT_HPP
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One rank's end of a unidirectional ring: messages go to rank + 1 and come
+// from rank - 1, in order. A send may still be in flight while the caller
+// computes; its buffer must stay untouched until WaitSend.
+class RingTransport {
+public:
+    virtual ~RingTransport() = default;
+
+    virtual bool StartSend(const void* data, std::size_t bytes) = 0;
+    virtual bool WaitSend() = 0;
+    // Blocks until the previous rank's next message has been copied into data.
+    virtual bool Receive(void* data, std::size_t bytes) = 0;
+
+    int rank = 0;
+    int ranks = 1;
+    // Polled while a transport waits on shared memory; once it returns false
+    // the wait gives up and the call fails. Sockets see a dead peer as EOF.
+    std::function<bool()> peersAlive;
+};
+
+enum class TransportKind {
+    SharedMemory, // POSIX shared-memory mailboxes, double-buffered
+    Socket, // Unix socket pairs
+};
+bool ParseTransport(const std::string& name, TransportKind& kind);
+
+// Builds every endpoint of a ring of `ranks` local processes, messages up to
+// maxMessage bytes. Call before forking; each process keeps its own endpoint
+// and drops the others. Returns an empty vector on failure.
+std::vector<std::unique_ptr<RingTransport>> CreateRing(TransportKind kind, int ranks, std::size_t maxMessage);
+
+#endif // TRANSPORT_HPP
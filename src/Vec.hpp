@@ -1,18 +1,91 @@
 #ifndef VECTOR_HPP
 #define VECTOR_HPP
 
-struct Vec2 {
-    double x = 0, y = 0;
+#include <cmath>
+
+// Fixed-size vector of D components of type T. The 2D and 3D shapes keep named
+// x/y/z members; generic code indexes them with operator[].
+template <typename T, int D>
+struct Vec;
+
+template <typename T>
+struct Vec<T, 2> {
+    T x = 0, y = 0;
+
+    constexpr T& operator[](int i) { return i == 0 ? x : y; }
+    constexpr const T& operator[](int i) const { return i == 0 ? x : y; }
+};
+
+template <typename T>
+struct Vec<T, 3> {
+    T x = 0, y = 0, z = 0;
+
+    constexpr T& operator[](int i) { return i == 0 ? x : i == 1 ? y : z; }
+    constexpr const T& operator[](int i) const { return i == 0 ? x : i == 1 ? y : z; }
 };
 
-Vec2 sub(Vec2 a, Vec2 b);
-Vec2 add(Vec2 a, Vec2 b);
-Vec2 scale(Vec2 a, double s);
+using Vec2 = Vec<double, 2>;
+using Vec3 = Vec<double, 3>;
+
+template <typename T, int D>
+constexpr Vec<T, D> sub(Vec<T, D> a, Vec<T, D> b)
+{
+    Vec<T, D> r;
+    for (int k = 0; k < D; k++)
+        r[k] = a[k] - b[k];
+    return r;
+}
+
+template <typename T, int D>
+constexpr Vec<T, D> add(Vec<T, D> a, Vec<T, D> b)
+{
+    Vec<T, D> r;
+    for (int k = 0; k < D; k++)
+        r[k] = a[k] + b[k];
+    return r;
+}
+
+template <typename T, int D>
+constexpr Vec<T, D> scale(Vec<T, D> a, T s)
+{
+    Vec<T, D> r;
+    for (int k = 0; k < D; k++)
+        r[k] = a[k] * s;
+    return r;
+}
+
+template <typename T, int D>
+constexpr T dot(Vec<T, D> a, Vec<T, D> b)
+{
+    T sum = 0;
+    for (int k = 0; k < D; k++)
+        sum += a[k] * b[k];
+    return sum;
+}
+
+template <typename T, int D>
+constexpr T distSqrd(Vec<T, D> v1, Vec<T, D> v2)
+{
+    Vec<T, D> diff = sub(v1, v2);
+    return dot(diff, diff);
+}
 
-double distSqrd(Vec2 v1, Vec2 v2);
+template <typename T, int D>
+inline T dist(Vec<T, D> v1, Vec<T, D> v2)
+{
+    return std::sqrt(distSqrd(v1, v2));
+}
 
-double dist(Vec2 v1, Vec2 v2);
+template <typename T, int D>
+inline Vec<T, D> Direction(Vec<T, D> from, Vec<T, D> to)
+{
+    Vec<T, D> dir = sub(to, from);
+    T distance = dist(from, to);
 
-Vec2 Direction(Vec2 from, Vec2 to);
+    if (distance < T(0.000001)) {
+        return Vec<T, D>();
+    }
+    return scale(dir, 1 / distance);
+}
 
 #endif // VECTOR_HPP
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <charconv>
 #include <chrono>
 #include <cmath>
 #include <ctime>
@@ -7,18 +8,26 @@
 #include <functional>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <omp.h>
 
 #include "Vec.hpp"
+#include <Pipeline.hpp>
 #include <Simulation.hpp>
 
-#include "utils.hpp"
 #include <Body.hpp>
+#include <AutoTune.hpp>
+#include <Benchmark.hpp>
+#include <Engines.hpp>
+#include <InitialConditions.hpp>
+#include <Morton.hpp>
+#include <Numa.hpp>
 #include <Renderer.hpp>
+#include <Trace.hpp>
+#include <Trajectory.hpp>
 
 #include <ostream>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #define G 9.8
@@ -31,187 +40,421 @@ std::vector<Body>
 CopyBodies(const std::vector<Body>& bodies)
 {
     std::vector<Body> out(bodies.size());
-    std::vector<Body> bodiesRender(bodies.size());
     for (int i = 0; i < out.size(); i++) {
         out[i] = bodies[i];
     }
     return out;
 }
 
-double BenchMark(std::function<void(std::vector<Body>&, double)> calc, std::function<void(std::vector<Body>&, double, int, int)> update, std::vector<Body>& bodies, const std::string& name, int frames)
+std::vector<std::string> SplitList(const std::string& list)
 {
-    const auto start(std::chrono::steady_clock::now());
-    for (int i = 0; i < frames; i++) {
-        calc(bodies, G);
-        update(bodies, DT, WIDTH, HEIGHT);
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        if (end > start)
+            out.push_back(list.substr(start, end - start));
+        start = end + 1;
     }
-    const auto end(std::chrono::steady_clock::now());
-    std::chrono::duration<double> seconds { end - start };
-
-    std::cout << name << " took: " << seconds.count() << " Seconds" << std::endl;
-
-    return seconds.count();
+    return out;
 }
 
-Vec2 CompareFinalPositions(const std::vector<Body>& sequential, const std::vector<Body>& bodies)
+// Whole-string numeric parse; false on junk, trailing characters or overflow.
+template <typename T>
+bool ParseNumber(const std::string& text, T& out)
 {
-    Vec2 cumulative = { 0, 0 };
+    T value;
+    const char* end = text.data() + text.size();
+    std::from_chars_result result = std::from_chars(text.data(), end, value);
+    if (text.empty() || result.ec != std::errc() || result.ptr != end)
+        return false;
+    out = value;
+    return true;
+}
 
-    for (int i = 0; i < bodies.size(); i++) {
-        cumulative = add(cumulative, sub(sequential[i].position, bodies[i].position));
+bool ParseIntList(const std::string& list, std::vector<int>& out)
+{
+    std::vector<int> values;
+    for (const std::string& item : SplitList(list)) {
+        int value;
+        if (!ParseNumber(item, value))
+            return false;
+        values.push_back(value);
     }
+    if (values.empty())
+        return false;
+    out = values;
+    return true;
+}
 
-    return { cumulative.x / bodies.size(), cumulative.y / bodies.size() };
+int InvalidValue(const std::string& flag, const char* value)
+{
+    std::cerr << "Invalid value for " << flag << ": " << value << std::endl;
+    return 1;
 }
 
+static InitialConditions initialConditions;
+
 std::vector<Body> GenerateBodiesMT(int size)
 {
-    std::vector<Body> bodies(size);
-#pragma omp parallel for
-    for (int i = 0; i < bodies.size(); i++) {
-        Body b;
-        b.position = { generate_random_double(100, WIDTH - 100), generate_random_double(100, HEIGHT - 100) };
-        b.velocity = { 0, 0 };
-        b.mass = generate_random_double(10, 100);
-        bodies[i] = b;
-    }
-    return bodies;
+    return GenerateBodies(size, initialConditions);
 }
 
-void BenchMarkAllCSV(const std::string& csvPath, const std::vector<int>& bodyCounts, const std::vector<int>& threadCounts)
+// Renders a recorded trajectory straight from the mapped file, no simulation.
+void ReplayTrajectory(const std::string& path, const char* gifPath)
 {
-    if (std::filesystem::exists(csvPath)) {
-        std::filesystem::remove(csvPath);
+    TrajectoryReader reader(path);
+    if (!reader.IsOpen())
+        return;
+
+    std::cout << "===Replaying " << reader.Steps() << " steps from " << path << "===" << std::endl;
+
+    std::vector<Body> bodies;
+    FrameBuffer frame(WIDTH, HEIGHT);
+    GifStream gif(gifPath, WIDTH, HEIGHT);
+    for (int k = 0; k < reader.Steps(); k++) {
+        reader.Read(k, bodies);
+        RenderFrame(bodies, frame);
+        gif.WriteFrame(frame.pixels);
     }
+}
 
-    printf("======== NUM BODIES SCALING BENCHMARK ========\n");
-
-    int fixedFrames = 1;
-    typedef std::unordered_map<std::string, std::vector<double>> TimeMap;
-
-    std::vector<TimeMap> times(threadCounts.size());
-
-    for (TimeMap& m : times) {
-        for (auto& [name, bTimes] : m) {
-            bTimes.resize(bodyCounts.size());
+#define FRAMES 700
+// 3D run through the generic Direct engine: z reflects off [0, depth] like x
+// and y, and the frames show the projection onto the x/y plane.
+void RunSimulation3D(int frames)
+{
+    const double depth = std::min(WIDTH, HEIGHT);
+    std::vector<Body3> bodies = GenerateBodies3(35, initialConditions, depth);
+    std::vector<Body> projected(bodies.size());
+    const Vec3 extent = { WIDTH, HEIGHT, depth };
+    std::vector<Vec3> accelerations;
+
+    std::cout << "===Simulating and rendering in 3D....===" << std::endl;
+    PinOpenMPThreads();
+
+    FrameBuffer frame(WIDTH, HEIGHT);
+    GifStream gif("simulation.gif", WIDTH, HEIGHT);
+    for (int f = 0; f < frames; f++) {
+        {
+            TRACE_SCOPE("step", "simulate");
+            CalculateForcesDirect<SoftenedGravity>(bodies, G, accelerations);
+            UpdateDirect(bodies, DT, extent);
+        }
+        for (int i = 0; i < bodies.size(); i++) {
+            projected[i].position = { bodies[i].position.x, bodies[i].position.y };
+            projected[i].velocity = { bodies[i].velocity.x, bodies[i].velocity.y };
+            projected[i].mass = bodies[i].mass;
         }
+        RenderFrame(projected, frame);
+        gif.WriteFrame(frame.pixels);
     }
+}
 
-    for (int index = 0; index < bodyCounts.size(); index++) {
-        int numBodies = bodyCounts[index];
-        auto bodies = GenerateBodiesMT(numBodies);
-
-        printf("--- BODIES: %d ---\n\n", numBodies);
+// A run is `frames` steps long counting from step 0, so a resumed run only
+// does the steps the interrupted one had left.
+void RunSimulation(const std::string& resumePath, const std::string& trajectoryPath, bool quantize, const std::string& checkpointPath, int checkpointEvery, const Integrator* integrator, const BlockTimestepConfig* blockSteps,
+    const std::string& profilePath, bool retune, int reorderEvery, int frames)
+{
+    std::vector<Body> bds;
+    uint64_t stepNumber = 0;
+    if (!resumePath.empty()) {
+        if (!LoadCheckpoint(resumePath, bds, stepNumber)) {
+            std::cerr << "Could not resume from " << resumePath << std::endl;
+            return;
+        }
+        std::cout << "Resuming from step " << stepNumber << std::endl;
+    } else {
+        bds = GenerateBodiesMT(35);
+    }
 
-        // Sequential benchmark
+    if (stepNumber >= (uint64_t)frames) {
+        std::cout << "Nothing left to run: already at step " << stepNumber << " of " << frames << std::endl;
+        return;
+    }
+    const int remaining = frames - (int)stepNumber;
+
+    // A resumed run continues the trajectory it was writing.
+    std::unique_ptr<TrajectoryWriter> trajectory;
+    if (!trajectoryPath.empty() && !resumePath.empty())
+        trajectory = std::make_unique<TrajectoryWriter>(trajectoryPath, bds.size(), DT, quantize, stepNumber);
+    else if (!trajectoryPath.empty())
+        trajectory = std::make_unique<TrajectoryWriter>(trajectoryPath, bds.size(), DT, quantize);
+
+    // Without a profile the original reduction engine is used as before.
+    Engine engine = { "reduction-dynamic", CalculateForcesMTReduction, UpdateMT, true };
+    TunedConfig tuned;
+    int tunedBucket = -1;
+    bool applied = true;
+    bool pinned = false;
+    auto tune = [&](const std::vector<Body>& b) {
+        tuned = TunedConfigFor(b, G, DT, WIDTH, HEIGHT, profilePath, retune);
+        FindEngine(tuned.engine, engine);
+        tunedBucket = SizeBucket(b.size());
+        applied = false;
+        std::cout << "Tuned engine: " << tuned.engine << " with " << tuned.threads << " threads" << std::endl;
+    };
+    if (!profilePath.empty() && !integrator && !blockSteps)
+        tune(bds);
+
+    std::cout << "===Simulating and rendering....===" << std::endl;
+
+    // Owns the bodies and every engine buffer for the whole run.
+    Simulation sim(std::move(bds), G, DT, WIDTH, HEIGHT);
+
+    // Bodies are periodically re-sorted into Morton order; ids maps each slot back
+    // to the body's original index so saved output keeps the original order.
+    std::vector<int> ids;
+    std::vector<Body> original;
+    auto inOriginalOrder = [&](const std::vector<Body>& b) -> const std::vector<Body>& {
+        if (ids.empty())
+            return b;
+        RestoreOriginalOrder(b, ids, original);
+        return original;
+    };
+
+    FusedState fusedState;
+    BlockTimestepState blockState;
+    auto step = [&](std::vector<Body>& b) {
+        if (reorderEvery > 0 && stepNumber % reorderEvery == 0) {
+            TRACE_SCOPE("reorder", "update");
+            ReorderMorton(b, ids);
+        }
+        if (tunedBucket >= 0 && SizeBucket(b.size()) != tunedBucket)
+            tune(b);
+        // Thread counts and pinning are per thread in OpenMP, so apply them on the
+        // thread that steps.
+        if (!applied) {
+            ApplyTunedConfig(tuned);
+            applied = true;
+            pinned = false;
+        }
+        if (!pinned) {
+            PinOpenMPThreads();
+            pinned = true;
+        }
 
-        for (int i = 0; i < threadCounts.size(); i++) {
-            int threadCount = threadCounts[i];
-            omp_set_num_threads(threadCount); // Set the number of threads for each run
+        if (integrator) {
+            TRACE_SCOPE("fused step", "force");
+            SimulateFused(b, G, DT, WIDTH, HEIGHT, 1, *integrator, &fusedState);
+        } else if (blockSteps) {
+            TRACE_SCOPE("block step", "force");
+            SimulateBlockTimesteps(b, G, DT, WIDTH, HEIGHT, 1, *blockSteps, &blockState);
+        } else if (!RunEngine(engine, sim, 1)) {
+            std::cerr << "Engine " << engine.name << " failed at step " << stepNumber << std::endl;
+        }
+        stepNumber++;
 
-            std::vector<Body> seqBds = CopyBodies(bodies);
-            std::string name = "Sequential Threads: " + std::to_string(threadCount);
-            double time = BenchMark(CalculateForcesSequential, UpdateSequential, seqBds, name, fixedFrames);
-            times[i][name].push_back(time);
-            {
-                std::vector<Body> bds = CopyBodies(bodies);
-                name = "MultiThreaded (Reduction - Dynamic) Threads: " + std::to_string(threadCount);
-                time = BenchMark(CalculateForcesMTReduction, UpdateMT, bds, name, fixedFrames);
-                Vec2 avgDiff = CompareFinalPositions(seqBds, bds);
-                times[i][name].push_back(time);
-            }
+        if (trajectory)
+            trajectory->Append(inOriginalOrder(b), stepNumber);
+        if (!checkpointPath.empty() && stepNumber % checkpointEvery == 0)
+            SaveCheckpoint(checkpointPath, inOriginalOrder(b), stepNumber, DT);
+    };
+    RunRenderPipeline(sim.bodies, step, remaining, WIDTH, HEIGHT, "simulation.gif");
 
-            {
-                std::vector<Body> bds = CopyBodies(bodies);
-                name = "MultiThreaded (Reduction - Static) Threads: " + std::to_string(threadCount);
-                time = BenchMark(CalculateForcesMTReductionStatic, UpdateMT, bds, name, fixedFrames);
-                Vec2 avgDiff = CompareFinalPositions(seqBds, bds);
-                times[i][name].push_back(time);
-            }
+    if (!checkpointPath.empty())
+        SaveCheckpoint(checkpointPath, inOriginalOrder(sim.bodies), stepNumber, DT);
+}
 
-            {
-                std::vector<Body> bds = CopyBodies(bodies);
-                name = "MultiThreaded (Atomic - Dynamic) Threads: " + std::to_string(threadCount);
-                time = BenchMark(CalculateForcesMTAtomic, UpdateMT, bds, name, fixedFrames);
-                Vec2 avgDiff = CompareFinalPositions(seqBds, bds);
-                times[i][name].push_back(time);
+int main(int argc, char** argv)
+{
+    std::string trajectoryPath, checkpointPath, resumePath, replayPath;
+    int checkpointEvery = 100;
+    bool quantize = false;
+    bool benchmark = false;
+    std::string csvPath = "benchmark_results.csv", jsonPath;
+    std::string tracePath;
+    bool perfCounters = false;
+    Integrator integrator;
+    bool useIntegrator = false;
+    BlockTimestepConfig blockSteps;
+    bool useBlockSteps = false;
+    std::string profilePath = "nbody_profile.tsv";
+    bool retune = false;
+    bool tuneOnly = false;
+    int reorderEvery = 0;
+    int frames = FRAMES;
+    int dimensions = 2;
+
+    BenchmarkConfig bench;
+    bench.bodyCounts = { 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000, 2000, 3000, 5000 };
+    // Of course, this many threads is alot and would only really be useful on high perf computers
+    // (Like mayeb Centaurous)
+    bench.threadCounts = { 1, 2, 4, 8, 16, 32, 64, 128 };
+    for (const Engine& e : Engines())
+        bench.engines.push_back(e.name);
+    bench.gravity = G;
+    bench.deltaTime = DT;
+    bench.width = WIDTH;
+    bench.height = HEIGHT;
+    bench.generate = [](int n, int system) {
+        // Each system of an ensemble gets its own seed.
+        InitialConditions ic = initialConditions;
+        ic.seed += system;
+        return GenerateBodies(n, ic);
+    };
+    initialConditions.gravity = G;
+    initialConditions.engineStep = DT;
+    initialConditions.width = WIDTH;
+    initialConditions.height = HEIGHT;
+
+    for (int a = 1; a < argc; a++) {
+        std::string arg = argv[a];
+        bool hasValue = a + 1 < argc;
+        if (arg == "--trajectory" && hasValue)
+            trajectoryPath = argv[++a];
+        else if (arg == "--quantize")
+            quantize = true;
+        else if (arg == "--checkpoint" && hasValue)
+            checkpointPath = argv[++a];
+        else if (arg == "--checkpoint-every" && hasValue) {
+            if (!ParseNumber(argv[++a], checkpointEvery))
+                return InvalidValue(arg, argv[a]);
+            checkpointEvery = std::max(1, checkpointEvery);
+        } else if (arg == "--frames" && hasValue) {
+            if (!ParseNumber(argv[++a], frames))
+                return InvalidValue(arg, argv[a]);
+            frames = std::max(1, frames);
+        } else if (arg == "--dim" && hasValue) {
+            if (!ParseNumber(argv[++a], dimensions) || (dimensions != 2 && dimensions != 3))
+                return InvalidValue(arg, argv[a]);
+        } else if (arg == "--resume" && hasValue)
+            resumePath = argv[++a];
+        else if (arg == "--replay" && hasValue)
+            replayPath = argv[++a];
+        else if (arg == "--bench")
+            benchmark = true;
+        else if (arg == "--engines" && hasValue)
+            bench.engines = SplitList(argv[++a]);
+        else if (arg == "--bodies" && hasValue) {
+            if (!ParseIntList(argv[++a], bench.bodyCounts))
+                return InvalidValue(arg, argv[a]);
+        } else if (arg == "--threads" && hasValue) {
+            if (!ParseIntList(argv[++a], bench.threadCounts))
+                return InvalidValue(arg, argv[a]);
+        } else if (arg == "--systems" && hasValue) {
+            if (!ParseNumber(argv[++a], bench.systems))
+                return InvalidValue(arg, argv[a]);
+            bench.systems = std::max(1, bench.systems);
+        } else if (arg == "--steps" && hasValue) {
+            if (!ParseNumber(argv[++a], bench.steps))
+                return InvalidValue(arg, argv[a]);
+            bench.steps = std::max(1, bench.steps);
+        } else if (arg == "--warmup" && hasValue) {
+            if (!ParseNumber(argv[++a], bench.warmup))
+                return InvalidValue(arg, argv[a]);
+            bench.warmup = std::max(0, bench.warmup);
+        } else if (arg == "--trials" && hasValue) {
+            if (!ParseNumber(argv[++a], bench.trials))
+                return InvalidValue(arg, argv[a]);
+            bench.trials = std::max(1, bench.trials);
+        } else if (arg == "--csv" && hasValue)
+            csvPath = argv[++a];
+        else if (arg == "--json" && hasValue)
+            jsonPath = argv[++a];
+        else if (arg == "--trace" && hasValue)
+            tracePath = argv[++a];
+        else if (arg == "--perf-counters")
+            perfCounters = true;
+        else if (arg == "--integrator" && hasValue) {
+            if (!ParseIntegrator(argv[++a], integrator)) {
+                std::cerr << "Unknown integrator: " << argv[a] << " (leapfrog, verlet, yoshida4)" << std::endl;
+                return 1;
             }
-
-            {
-                std::vector<Body> bds = CopyBodies(bodies);
-                name = "MultiThreaded (Atomic - Static) Threads: " + std::to_string(threadCount);
-                time = BenchMark(CalculateForcesMTAtomicStatic, UpdateMT, bds, name, fixedFrames);
-                Vec2 avgDiff = CompareFinalPositions(seqBds, bds);
-                times[i][name].push_back(time);
+            useIntegrator = true;
+        } else if (arg == "--block-levels" && hasValue) {
+            if (!ParseNumber(argv[++a], blockSteps.maxLevel))
+                return InvalidValue(arg, argv[a]);
+            blockSteps.maxLevel = std::max(0, blockSteps.maxLevel);
+            useBlockSteps = true;
+        } else if (arg == "--block-eta" && hasValue) {
+            if (!ParseNumber(argv[++a], blockSteps.eta) || !(blockSteps.eta > 0))
+                return InvalidValue(arg, argv[a]);
+            useBlockSteps = true;
+        } else if (arg == "--distribution" && hasValue) {
+            if (!ParseDistribution(argv[++a], initialConditions.distribution)) {
+                std::cerr << "Unknown distribution: " << argv[a] << " (uniform, plummer, disk, clusters)" << std::endl;
+                return 1;
             }
-
-            {
-                std::vector<Body> bds = CopyBodies(bodies);
-                name = "MultiThreaded (Critical) Threads: " + std::to_string(threadCount);
-                time = BenchMark(CalculateForcesMTCritical, UpdateMT, bds, name, fixedFrames);
-                Vec2 avgDiff = CompareFinalPositions(seqBds, bds);
-                times[i][name].push_back(time);
+        } else if (arg == "--seed" && hasValue) {
+            if (!ParseNumber(argv[++a], initialConditions.seed))
+                return InvalidValue(arg, argv[a]);
+        } else if (arg == "--profile" && hasValue) {
+            profilePath = argv[++a];
+        } else if (arg == "--no-tune") {
+            profilePath.clear();
+        } else if (arg == "--retune") {
+            retune = true;
+        } else if (arg == "--tune") {
+            tuneOnly = true;
+        } else if (arg == "--reorder-every" && hasValue) {
+            if (!ParseNumber(argv[++a], reorderEvery))
+                return InvalidValue(arg, argv[a]);
+            reorderEvery = std::max(0, reorderEvery);
+            bench.reorder = reorderEvery > 0;
+        } else if (arg == "--affinity" && hasValue) {
+            Affinity affinity;
+            if (!ParseAffinity(argv[++a], affinity)) {
+                std::cerr << "Unknown affinity: " << argv[a] << " (none, compact, scatter)" << std::endl;
+                return 1;
             }
+            SetAffinity(affinity);
+        } else if (arg == "--list-engines") {
+            for (const Engine& e : Engines())
+                std::cout << e.name << (e.exact ? "" : " (approximate)") << std::endl;
+            return 0;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            return 1;
         }
     }
 
-    int index = 0;
-    for (auto& m : times) {
-        std::fstream stream(std::to_string(index) + "_" + csvPath, std::ios::out);
-        index++;
-        stream << "Method";
-        for (auto num : bodyCounts) {
-            stream << "," << num;
-        }
-        stream << "\n";
+    // The fused integrators and block timesteps apply v += a dt themselves.
+    if (useIntegrator || useBlockSteps)
+        initialConditions.engineStep = 0;
 
-        for (auto [name, bTimes] : m) {
-            stream << name;
-            for (double t : bTimes) {
-                stream << "," << t;
-            }
-            stream << "\n";
-        }
-        stream.close();
+    if (!replayPath.empty()) {
+        ReplayTrajectory(replayPath, "simulation.gif");
+        return 0;
     }
-}
 
-#define FRAMES 700
-int main()
-{
     int num_threads = omp_get_max_threads();
     std::cout << "Default number of threads: " << num_threads << std::endl;
-    std::vector<int> bodyCounts = { 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000, 2000, 3000, 5000 };
+    std::cout << "SIMD kernel: " << SIMDKernelName() << std::endl;
+    std::cout << "Force tiles: " << GetTileConfig().iBlock << "x" << GetTileConfig().jTile << std::endl;
+    std::cout << "NUMA nodes: " << NumaNodeCount() << std::endl;
 
-    // Of course, this many threads is alot and would only really be useful on high perf computers
-    // (Like mayeb Centaurous)
-    std::vector<int> threadCounts = { 1, 2, 4, 8, 16, 32, 64, 128 };
-
-    BenchMarkAllCSV("benchmark_results.csv", bodyCounts, threadCounts);
-
-    {
-        std::vector<Body> bds = GenerateBodiesMT(35);
-
-        std::vector<std::vector<Body>> frameStates;
-
-        for (int i = 0; i < FRAMES; i++) {
-
-            CalculateForcesMTReduction(bds, G);
-            UpdateMT(bds, DT, WIDTH, HEIGHT);
-            frameStates.push_back(CopyBodies(bds));
-        }
-
-        std::cout << "===Rendering....===" << std::endl;
-
-        std::vector<std::vector<unsigned char>> frames(frameStates.size());
+    if (!tracePath.empty()) {
+        StartTracing(perfCounters);
+    }
 
-#pragma omp parallel for
-        for (int i = 0; i < frameStates.size(); i++) {
-            frames[i] = std::move(RenderFrame(frameStates[i], WIDTH, HEIGHT));
+    if (tuneOnly) {
+        for (int n : bench.bodyCounts) {
+            TunedConfig config = TunedConfigFor(GenerateBodiesMT(n), G, DT, WIDTH, HEIGHT, profilePath, true);
+            std::cout << n << " bodies: " << config.engine << " with " << config.threads << " threads, "
+                      << config.secondsPerStep << "s per step" << std::endl;
         }
+    } else if (benchmark) {
+        std::vector<BenchmarkResult> results = RunBenchmarks(bench);
+        if (!csvPath.empty())
+            WriteBenchmarkCSV(csvPath, results);
+        if (!jsonPath.empty())
+            WriteBenchmarkJSON(jsonPath, results);
+    } else if (dimensions == 3) {
+        RunSimulation3D(frames);
+    } else {
+        RunSimulation(resumePath, trajectoryPath, quantize, checkpointPath, checkpointEvery, useIntegrator ? &integrator : nullptr,
+            useBlockSteps ? &blockSteps : nullptr, profilePath, retune, reorderEvery, frames);
+    }
 
-        WriteGif(frames, WIDTH, HEIGHT, "simulation.gif");
+    if (!tracePath.empty()) {
+        if (perfCounters && !HardwareCountersAvailable())
+            std::cerr << "Hardware counters unavailable (perf_event_open refused); trace has timings only" << std::endl;
+        WriteTrace(tracePath);
     }
 
     return 0;
 }
+